@@ -0,0 +1,65 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Compare a checked [guile_fn] with an `unsafe(trusted)` one taking a list, whose predicate checks every element.
+//!
+//! Run with `cargo bench --bench trusted`, since debug builds check trusted arguments too.
+
+use {
+    garguile::{
+        Guile,
+        collections::list::List,
+        reference::ReprScm,
+        scm::Scm,
+        subr::{GuileFn, Proc, guile_fn},
+        with_guile,
+    },
+    std::{
+        hint::black_box,
+        time::{Duration, Instant},
+    },
+};
+
+#[guile_fn]
+fn checked_head(lst: &List<i32>) -> bool {
+    !lst.is_empty()
+}
+
+#[guile_fn(unsafe(trusted))]
+fn trusted_head(lst: &List<i32>) -> bool {
+    !lst.is_empty()
+}
+
+const LENGTH: i32 = 1000;
+const CALLS: u32 = 10_000;
+
+fn time<'gm>(mut proc: Proc<'gm>, lst: &List<'gm, i32>, guile: &'gm Guile) -> Duration {
+    let start = Instant::now();
+    (0..CALLS).for_each(|_| {
+        let lst = Scm::from_ptr(black_box(lst).as_ptr(), guile);
+        black_box(unsafe { proc.call::<1, _, bool>((lst,)) }.unwrap());
+    });
+    start.elapsed() / CALLS
+}
+
+fn main() {
+    with_guile(|guile| {
+        let lst = List::from_iter(0..LENGTH, guile);
+        let checked = time(CheckedHead::create(guile), &lst, guile);
+        let trusted = time(TrustedHead::create(guile), &lst, guile);
+        println!("list of {LENGTH}: checked {checked:?}/call, trusted {trusted:?}/call");
+    })
+    .unwrap();
+}
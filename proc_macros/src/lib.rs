@@ -17,16 +17,18 @@
 
 mod fn_args;
 mod macro_args;
+mod scm_repr;
 
 use {
     crate::{
         fn_args::{FnArgs, Rest},
         macro_args::Config,
+        scm_repr::ScmRepr,
     },
     convert_case::{Case, Casing},
     proc_macro::TokenStream,
     proc_macro2::Span,
-    quote::quote,
+    quote::{format_ident, quote},
     std::{borrow::Cow, ffi::CString, iter},
     syn::{
         Attribute, DeriveInput, Expr, ExprLit, ExprPath, FnArg, GenericParam, Generics, Ident,
@@ -45,6 +47,8 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
                 struct_ident,
                 doc,
                 garguile_root,
+                trusted,
+                pure,
             } = Config::new(args, &input);
             FnArgs::try_from(input.clone())
                 .map(
@@ -60,7 +64,7 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
                             ..
                         } = input;
 
-                        let _doc = doc.map(|doc| quote! { Some(#doc) }).unwrap_or_else(|| quote! { None });
+                        let doc = doc.map(|doc| quote! { ::std::option::Option::Some(#doc) }).unwrap_or_else(|| quote! { ::std::option::Option::None });
 
                         let required_len = required.len();
                         let optional_len = optional.len();
@@ -92,6 +96,20 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
 
                         let guile = guile.then(|| quote! { guile, });
 
+                        let (unsafety, convert, convert_option) = if trusted {
+                            (
+                                Some(quote! { unsafe }),
+                                quote! { #garguile_root::subr::from_scm_trusted },
+                                quote! { #garguile_root::subr::from_scm_trusted::<::std::option::Option<_>> },
+                            )
+                        } else {
+                            (
+                                None,
+                                quote! { #garguile_root::scm::TryFromScm::from_scm_or_throw },
+                                quote! { <::std::option::Option<_> as #garguile_root::scm::TryFromScm>::from_scm_or_throw },
+                            )
+                        };
+
                         let rest_idx = rest.as_ref().and_then(|rest| match rest {
                             Rest::Keyword(_) => None,
                             Rest::List(_) => Some(optional_len + required_len),
@@ -105,8 +123,34 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
                             Rest::List(_) => Some(quote! { rest }),
                         }).into_iter();
 
+                        // `call` takes the same parameters as the function, renamed since they may be patterns
+                        let mut call_sig = input.sig.clone();
+                        call_sig.ident = Ident::new("call", Span::call_site());
+                        let call_args = (0..call_sig.inputs.len()).map(|i| format_ident!("arg_{i}")).collect::<Vec<_>>();
+                        call_sig.inputs = call_sig.inputs.iter().zip(&call_args).map(|(arg, ident)| match arg {
+                            FnArg::Typed(PatType { ty, .. }) => parse_quote! { #ident: #ty },
+                            FnArg::Receiver(receiver) => FnArg::Receiver(receiver.clone()),
+                        }).collect();
+                        let call_body = if call_sig.unsafety.is_some() {
+                            quote! { unsafe { #ident(#(#call_args),*) } }
+                        } else {
+                            quote! { #ident(#(#call_args),*) }
+                        };
+
                         quote! {
                             #vis struct #struct_ident;
+                            impl #struct_ident {
+                                /// Call the function directly, without going through the VM or checking the arguments.
+                                ///
+                                /// `Proc::is` checks whether a procedure is this one.
+                                #[inline]
+                                #vis #call_sig {
+                                    #call_body
+                                }
+                            }
+                            impl #garguile_root::subr::NamedGuileFn for #struct_ident {
+                                const NAME: &'static ::std::ffi::CStr = #guile_ident;
+                            }
                             impl #garguile_root::subr::GuileFn for #struct_ident {
                                 fn create<'gm>(guile: &'gm #garguile_root::Guile) -> #garguile_root::subr::Proc<'gm> {
                                     unsafe extern "C" fn driver(
@@ -116,8 +160,8 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
                                     ) -> #garguile_root::sys::SCM {
                                         let guile = unsafe { #garguile_root::Guile::new_unchecked_ref() };
 
-                                        #(let #required_idents = ::std::mem::ManuallyDrop::new(#garguile_root::scm::TryFromScm::from_scm_or_throw(#garguile_root::scm::Scm::from_ptr(#required_idents, guile), #guile_ident, #required_idxs, guile));)*
-                                        #(let #optional_idents = <::std::option::Option<_> as #garguile_root::scm::TryFromScm>::from_scm_or_throw(#garguile_root::scm::Scm::from_ptr(#optional_idents, guile), #guile_ident, #optional_idxs, guile).map(::std::mem::ManuallyDrop::new);)*
+                                        #(let #required_idents = ::std::mem::ManuallyDrop::new(#unsafety { #convert(#garguile_root::scm::Scm::from_ptr(#required_idents, guile), #guile_ident, #required_idxs, guile) });)*
+                                        #(let #optional_idents = #unsafety { #convert_option(#garguile_root::scm::Scm::from_ptr(#optional_idents, guile), #guile_ident, #optional_idxs, guile) }.map(::std::mem::ManuallyDrop::new);)*
                                         #(#(static #keyword_static_idents: ::std::sync::LazyLock<::std::sync::atomic::AtomicPtr<#garguile_root::sys::scm_unused_struct>> = ::std::sync::LazyLock::new(|| {
                                             const SYMBOL: &'static ::std::primitive::str = #keyword_symbols;
                                             unsafe { #garguile_root::sys::scm_symbol_to_keyword(#garguile_root::sys::scm_from_utf8_symboln(SYMBOL.as_bytes().as_ptr().cast(), SYMBOL.len()))}.into()
@@ -128,8 +172,8 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
                                             #(#keyword_static_idents.load(::std::sync::atomic::Ordering::SeqCst), &raw mut #keyword_idents,)*
                                             #garguile_root::sys::SCM_UNDEFINED,
                                         ); }
-                                        #(let #keyword_idents = <::std::option::Option<_> as #garguile_root::scm::TryFromScm>::from_scm_or_throw(#garguile_root::scm::Scm::from_ptr(#keyword_idents, guile), #guile_ident, #keyword_idxs, guile).map(::std::mem::ManuallyDrop::new);)*)*
-                                        #(let #rest_ident: ::std::mem::ManuallyDrop<#garguile_root::collections::list::List<_>> = ::std::mem::ManuallyDrop::new(#garguile_root::scm::TryFromScm::from_scm_or_throw(#garguile_root::scm::Scm::from_ptr(#rest_list, guile), #guile_ident, #rest_idx, guile));)*
+                                        #(let #keyword_idents = #unsafety { #convert_option(#garguile_root::scm::Scm::from_ptr(#keyword_idents, guile), #guile_ident, #keyword_idxs, guile) }.map(::std::mem::ManuallyDrop::new);)*)*
+                                        #(let #rest_ident: ::std::mem::ManuallyDrop<#garguile_root::collections::list::List<_>> = ::std::mem::ManuallyDrop::new(#unsafety { #convert(#garguile_root::scm::Scm::from_ptr(#rest_list, guile), #guile_ident, #rest_idx, guile) });)*
 
                                         let ret = #ident(
                                             #guile
@@ -141,14 +185,17 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
                                         #garguile_root::reference::ReprScm::as_ptr(&#garguile_root::scm::ToScm::to_scm(ret, guile))
                                     }
                                     static PROC: ::std::sync::LazyLock<::std::sync::atomic::AtomicPtr<#garguile_root::sys::scm_unused_struct>> = ::std::sync::LazyLock::new(|| {
-                                        unsafe { #garguile_root::sys::scm_c_make_gsubr(#guile_ident.as_ptr().cast(), #required_len.try_into().unwrap(), #optional_len.try_into().unwrap(), #has_rest as ::std::ffi::c_int, driver as *mut ::std::ffi::c_void) }
+                                        unsafe { #garguile_root::subr::make_gsubr(#guile_ident, #required_len, #optional_len, #has_rest, #doc, #pure, driver as *mut ::std::ffi::c_void) }
                                         .into()
                                     });
 
-                                    <#garguile_root::subr::Proc as #garguile_root::scm::TryFromScm>::try_from_scm(#garguile_root::scm::Scm::from_ptr(
-                                        PROC.load(::std::sync::atomic::Ordering::Acquire),
-                                        guile,
-                                    ), guile).expect("`scm_c_make_gsubr` should always return a procedure")
+                                    // SAFETY: `make_gsubr` always returns a procedure
+                                    unsafe {
+                                        <#garguile_root::subr::Proc as #garguile_root::scm::TryFromScm>::from_scm_unchecked(#garguile_root::scm::Scm::from_ptr(
+                                            PROC.load(::std::sync::atomic::Ordering::Acquire),
+                                            guile,
+                                        ), guile)
+                                    }
                                 }
                             }
                         }
@@ -180,7 +227,7 @@ pub fn guile_fn(args: TokenStream, input: TokenStream) -> TokenStream {
         .into()
 }
 
-fn get_last_attr<'a, C, I, F, T>(
+fn get_last_attr<'a, C: ?Sized, I, F, T>(
     attrs: &'a C,
     ident: &str,
     mut filter: F,
@@ -287,6 +334,38 @@ pub fn foreign_object(input: TokenStream) -> TokenStream {
         .into()
 }
 
+#[proc_macro_derive(Record, attributes(garguile_root))]
+pub fn record(input: TokenStream) -> TokenStream {
+    syn::parse::<DeriveInput>(input)
+        .and_then(
+            |DeriveInput {
+                 attrs,
+                 ident,
+                 generics,
+                 data,
+                 ..
+             }| {
+                scm_repr::record_generics(&generics)
+                    .and_then(|_| garguile_root(&attrs))
+                    .and_then(|garguile_root| scm_repr::named_fields(&ident, &data).map(|fields| (garguile_root, fields)))
+                    .map(|(garguile_root, fields)| {
+                        let (impl_generics, ty_generics, where_clause) = generics.split_for_impl();
+                        let body = scm_repr::record(&garguile_root, &ident, &fields);
+
+                        quote! {
+                            impl #impl_generics #garguile_root::record::Record for #ident #ty_generics
+                            #where_clause
+                            {
+                                #body
+                            }
+                        }
+                    })
+            },
+        )
+        .unwrap_or_else(syn::Error::into_compile_error)
+        .into()
+}
+
 fn add_lifetime(lt: Lifetime, mut generics: Generics) -> Generics {
     if !generics.params.iter().any(|param| {
         matches!(param, GenericParam::Lifetime(LifetimeParam {
@@ -301,7 +380,7 @@ fn add_lifetime(lt: Lifetime, mut generics: Generics) -> Generics {
     generics
 }
 
-#[proc_macro_derive(ToScm, attributes(garguile_root, guile_mode_lt))]
+#[proc_macro_derive(ToScm, attributes(garguile_root, guile_mode_lt, scm_repr))]
 pub fn to_scm(input: TokenStream) -> TokenStream {
     syn::parse::<DeriveInput>(input)
         .and_then(
@@ -309,6 +388,7 @@ pub fn to_scm(input: TokenStream) -> TokenStream {
                  attrs,
                  ident,
                  generics,
+                 data,
                  ..
              }| {
                 garguile_root(&attrs)
@@ -318,7 +398,24 @@ pub fn to_scm(input: TokenStream) -> TokenStream {
                                   ident: ident.into_owned(),
                               })
                               .map(|gm| (garguile_root, gm)))
-                    .map(|(garguile_root, gm)| {
+                    .and_then(|(garguile_root, gm)| ScmRepr::new(&attrs).and_then(|repr| match repr {
+                        ScmRepr::ForeignObject => Ok((quote! {}, quote! {
+                            fn to_scm(self, guile: &'gm #garguile_root::Guile) -> #garguile_root::scm::Scm<'gm> {
+                                // we don't need to care about panicking or dynwind since the pointer is garbage collected
+                                let ptr = #garguile_root::reexports::allocator_api2::boxed::Box::into_raw(
+                                    #garguile_root::reexports::allocator_api2::boxed::Box::new_in(self, #garguile_root::alloc::GcAllocator::new(<Self as #garguile_root::scm::TryFromScm>::type_name().as_ref(), guile))
+                                );
+                                #garguile_root::scm::Scm::from_ptr(unsafe { #garguile_root::sys::scm_make_foreign_object_1(<Self as #garguile_root::foreign_object::ForeignObject>::get_or_create_type(), ptr.cast()) }, guile)
+                            }
+                        })),
+                        ScmRepr::Record => scm_repr::named_fields(&ident, &data)
+                            .map(|fields| (quote! {}, scm_repr::record_to_scm(&garguile_root, &gm, &fields))),
+                        ScmRepr::Enum => scm_repr::variants(&ident, &data)
+                            .map(|variants| (scm_repr::enum_symbols(&garguile_root, &variants), scm_repr::enum_to_scm(&garguile_root, &gm, &variants))),
+                        ScmRepr::Keyed(keyed) => scm_repr::named_fields(&ident, &data)
+                            .map(|fields| (scm_repr::keyed_keys(&garguile_root, keyed, &fields), scm_repr::keyed_to_scm(&garguile_root, &gm, keyed, &fields))),
+                    }).map(|(items, body)| (garguile_root, gm, items, body)))
+                    .map(|(garguile_root, gm, items, body)| {
                         let (_, ty_generics, _) = generics.split_for_impl();
                         let ty_generics = quote! { #ty_generics };
 
@@ -326,17 +423,15 @@ pub fn to_scm(input: TokenStream) -> TokenStream {
                         let (impl_generics, _, where_clause) = generics.split_for_impl();
 
                         quote! {
-                            impl #impl_generics #garguile_root::scm::ToScm<#gm> for #ident #ty_generics
-                            #where_clause
-                            {
-                                fn to_scm(self, guile: &'gm #garguile_root::Guile) -> #garguile_root::scm::Scm<'gm> {
-                                    // we don't need to care about panicking or dynwind since the pointer is garbage collected
-                                    let ptr = #garguile_root::reexports::allocator_api2::boxed::Box::into_raw(
-                                        #garguile_root::reexports::allocator_api2::boxed::Box::new_in(self, #garguile_root::alloc::GcAllocator::new(<Self as #garguile_root::scm::TryFromScm>::type_name().as_ref(), guile))
-                                    );
-                                    #garguile_root::scm::Scm::from_ptr(unsafe { #garguile_root::sys::scm_make_foreign_object_1(<Self as #garguile_root::foreign_object::ForeignObject>::get_or_create_type(), ptr.cast()) }, guile)
+                            const _: () = {
+                                #items
+
+                                impl #impl_generics #garguile_root::scm::ToScm<#gm> for #ident #ty_generics
+                                #where_clause
+                                {
+                                    #body
                                 }
-                            }
+                            };
                         }
                     })
             },
@@ -345,7 +440,10 @@ pub fn to_scm(input: TokenStream) -> TokenStream {
         .into()
 }
 
-#[proc_macro_derive(TryFromScm, attributes(garguile_root, guile_mode_lt, ty_name))]
+#[proc_macro_derive(
+    TryFromScm,
+    attributes(garguile_root, guile_mode_lt, ty_name, scm_repr)
+)]
 pub fn try_from_scm(input: TokenStream) -> TokenStream {
     syn::parse::<DeriveInput>(input)
         .and_then(
@@ -353,6 +451,7 @@ pub fn try_from_scm(input: TokenStream) -> TokenStream {
                  attrs,
                  ident,
                  generics,
+                 data,
                  ..
              }| {
                 garguile_root(&attrs)
@@ -369,7 +468,42 @@ pub fn try_from_scm(input: TokenStream) -> TokenStream {
                         expr => Err(syn::Error::new(expr.span(), "expected c string literal: `ty_name = c\"foo\"`"))
                     }, LitCStr::new(&CString::new(ident.to_string().to_case(Case::Kebab)).unwrap(), Span::call_site()))
                     .map(|ty_name| (root, gm, ty_name)))
-                    .map(|(garguile_root, gm, ty_name)| {
+                    .and_then(|(garguile_root, gm, ty_name)| ScmRepr::new(&attrs).and_then(|repr| match repr {
+                        ScmRepr::ForeignObject => Ok((quote! {}, quote! {
+                            fn predicate(scm: &#garguile_root::scm::Scm<#gm>, _: &#gm #garguile_root::Guile) -> bool {
+                                let b = unsafe {
+                                    #garguile_root::sys::SCM_IS_A_P(
+                                        #garguile_root::reference::ReprScm::as_ptr(scm),
+                                        <Self as #garguile_root::foreign_object::ForeignObject>::get_or_create_type(),
+                                    )
+                                };
+                                b != 0
+                            }
+
+                            unsafe fn from_scm_unchecked(scm: #garguile_root::scm::Scm<#gm>, _: &#gm #garguile_root::Guile) -> Self {
+                                let ptr = unsafe {
+                                    #garguile_root::sys::scm_foreign_object_ref(
+                                        #garguile_root::reference::ReprScm::as_ptr(&scm),
+                                        0,
+                                    )
+                                }.cast::<Self>();
+                                if ptr.is_null() {
+                                    ::std::panic!("unexpected null pointer")
+                                } else if ptr.is_aligned() {
+                                    unsafe { ptr.read() }
+                                } else {
+                                    unsafe { ptr.read_unaligned() }
+                                }
+                            }
+                        })),
+                        ScmRepr::Record => scm_repr::named_fields(&ident, &data)
+                            .map(|fields| (quote! {}, scm_repr::record_try_from_scm(&garguile_root, &gm, &fields))),
+                        ScmRepr::Enum => scm_repr::variants(&ident, &data)
+                            .map(|variants| (scm_repr::enum_symbols(&garguile_root, &variants), scm_repr::enum_try_from_scm(&garguile_root, &gm, &variants))),
+                        ScmRepr::Keyed(keyed) => scm_repr::named_fields(&ident, &data)
+                            .map(|fields| (scm_repr::keyed_keys(&garguile_root, keyed, &fields), scm_repr::keyed_try_from_scm(&garguile_root, &gm, keyed, &fields))),
+                    }).map(|(items, body)| (garguile_root, gm, ty_name, items, body)))
+                    .map(|(garguile_root, gm, ty_name, items, body)| {
                         let (_, ty_generics, _) = generics.split_for_impl();
                         let ty_generics = quote! { #ty_generics };
 
@@ -377,39 +511,19 @@ pub fn try_from_scm(input: TokenStream) -> TokenStream {
                         let (impl_generics, _, where_clause) = generics.split_for_impl();
 
                         quote! {
-                            impl #impl_generics #garguile_root::scm::TryFromScm<#gm> for #ident #ty_generics
-                            #where_clause
-                            {
-                                fn type_name() -> ::std::borrow::Cow<'static, ::std::ffi::CStr> {
-                                    ::std::borrow::Cow::Borrowed(#ty_name)
-                                }
-
-                                fn predicate(scm: &#garguile_root::scm::Scm<#gm>, _: &#gm #garguile_root::Guile) -> bool {
-                                    let b = unsafe {
-                                        #garguile_root::sys::SCM_IS_A_P(
-                                            #garguile_root::reference::ReprScm::as_ptr(scm),
-                                            <Self as #garguile_root::foreign_object::ForeignObject>::get_or_create_type(),
-                                        )
-                                    };
-                                    b != 0
-                                }
-
-                                unsafe fn from_scm_unchecked(scm: #garguile_root::scm::Scm<#gm>, _: &#gm #garguile_root::Guile) -> Self {
-                                    let ptr = unsafe {
-                                        #garguile_root::sys::scm_foreign_object_ref(
-                                            #garguile_root::reference::ReprScm::as_ptr(&scm),
-                                            0,
-                                        )
-                                    }.cast::<Self>();
-                                    if ptr.is_null() {
-                                        ::std::panic!("unexpected null pointer")
-                                    } else if ptr.is_aligned() {
-                                        unsafe { ptr.read() }
-                                    } else {
-                                        unsafe { ptr.read_unaligned() }
+                            const _: () = {
+                                #items
+
+                                impl #impl_generics #garguile_root::scm::TryFromScm<#gm> for #ident #ty_generics
+                                #where_clause
+                                {
+                                    fn type_name() -> ::std::borrow::Cow<'static, ::std::ffi::CStr> {
+                                        ::std::borrow::Cow::Borrowed(#ty_name)
                                     }
+
+                                    #body
                                 }
-                            }
+                            };
                         }
                     })
             },
@@ -19,7 +19,7 @@ use {
     std::{cell::LazyCell, ffi::CString},
     syn::{
         Attribute, Expr, ExprLit, Ident, ItemFn, Lit, LitCStr, LitStr, Meta, MetaNameValue, Path,
-        Signature, Token,
+        Signature, Token, parenthesized,
         parse::{Parse, ParseStream},
         parse_quote,
         punctuated::Punctuated,
@@ -32,6 +32,8 @@ mod keywords {
     custom_keyword!(struct_ident);
     custom_keyword!(doc);
     custom_keyword!(garguile_root);
+    custom_keyword!(trusted);
+    custom_keyword!(pure);
 
     custom_keyword!(r#false);
 }
@@ -41,6 +43,8 @@ enum Key {
     StructIdent,
     Doc,
     GarguileRoot,
+    Trusted,
+    Pure,
 }
 impl Parse for Key {
     fn parse(input: ParseStream) -> Result<Self, syn::Error> {
@@ -59,6 +63,30 @@ impl Parse for Key {
             input
                 .parse::<keywords::garguile_root>()
                 .map(|_| Self::GarguileRoot)
+        } else if lookahead.peek(Token![unsafe]) {
+            input.parse::<Token![unsafe]>().and_then(|_| {
+                let content;
+                parenthesized!(content in input);
+                content
+                    .parse::<keywords::trusted>()
+                    .map(|_| Self::Trusted)
+                    .and_then(|key| {
+                        if content.is_empty() {
+                            Ok(key)
+                        } else {
+                            Err(content.error("expected `)`"))
+                        }
+                    })
+            })
+        } else if lookahead.peek(keywords::trusted) {
+            input.parse::<keywords::trusted>().and_then(|trusted| {
+                Err(syn::Error::new(
+                    trusted.span,
+                    "calling a `trusted` procedure with the wrong types is undefined behavior, so it must be written as `unsafe(trusted)`",
+                ))
+            })
+        } else if lookahead.peek(keywords::pure) {
+            input.parse::<keywords::pure>().map(|_| Self::Pure)
         } else {
             Err(lookahead.error())
         }
@@ -70,6 +98,8 @@ enum Arg {
     StructIdent(Ident),
     Doc(Option<String>),
     GarguileRoot(Path),
+    Trusted,
+    Pure,
 }
 impl Parse for Arg {
     fn parse(input: ParseStream) -> Result<Self, syn::Error> {
@@ -105,6 +135,8 @@ impl Parse for Arg {
             Key::GarguileRoot => <Token![=]>::parse(input)
                 .and_then(|_| <Path as Parse>::parse(input))
                 .map(Self::GarguileRoot),
+            Key::Trusted => Ok(Self::Trusted),
+            Key::Pure => Ok(Self::Pure),
         })
     }
 }
@@ -121,6 +153,8 @@ pub struct Config {
     pub struct_ident: Ident,
     pub doc: Option<String>,
     pub garguile_root: Path,
+    pub trusted: bool,
+    pub pure: bool,
 }
 impl Config {
     pub fn new(
@@ -131,46 +165,51 @@ impl Config {
             ..
         }: &ItemFn,
     ) -> Self {
-        let (guile_ident, struct_ident, doc, garguile_root) = args.0.into_iter().fold(
-            (
-                None,
-                None,
-                Some(
-                    attrs
-                        .iter()
-                        .filter_map(|Attribute { meta, .. }| match meta {
-                            Meta::NameValue(MetaNameValue {
-                                path,
-                                value:
-                                    Expr::Lit(ExprLit {
-                                        lit: Lit::Str(doc), ..
-                                    }),
-                                ..
-                            }) if path.is_ident("doc") => Some(doc),
-                            _ => None,
-                        })
-                        .map(|doc| doc.value())
-                        .map(|mut doc| {
-                            doc.push('\n');
-                            doc
-                        })
-                        .collect::<String>()
-                        .trim_end()
-                        .to_string(),
-                )
-                .filter(|docs| !docs.is_empty()),
-                None,
-            ),
-            |mut accum, arg| {
-                match arg {
-                    Arg::GuileIdent(ident) => accum.0 = Some(ident),
-                    Arg::StructIdent(ident) => accum.1 = Some(ident),
-                    Arg::Doc(doc) => accum.2 = doc,
-                    Arg::GarguileRoot(root) => accum.3 = Some(root),
-                }
-                accum
-            },
-        );
+        let (guile_ident, struct_ident, doc, garguile_root, trusted, pure) =
+            args.0.into_iter().fold(
+                (
+                    None,
+                    None,
+                    Some(
+                        attrs
+                            .iter()
+                            .filter_map(|Attribute { meta, .. }| match meta {
+                                Meta::NameValue(MetaNameValue {
+                                    path,
+                                    value:
+                                        Expr::Lit(ExprLit {
+                                            lit: Lit::Str(doc), ..
+                                        }),
+                                    ..
+                                }) if path.is_ident("doc") => Some(doc),
+                                _ => None,
+                            })
+                            .map(|doc| doc.value())
+                            .map(|mut doc| {
+                                doc.push('\n');
+                                doc
+                            })
+                            .collect::<String>()
+                            .trim_end()
+                            .to_string(),
+                    )
+                    .filter(|docs| !docs.is_empty()),
+                    None,
+                    false,
+                    false,
+                ),
+                |mut accum, arg| {
+                    match arg {
+                        Arg::GuileIdent(ident) => accum.0 = Some(ident),
+                        Arg::StructIdent(ident) => accum.1 = Some(ident),
+                        Arg::Doc(doc) => accum.2 = doc,
+                        Arg::GarguileRoot(root) => accum.3 = Some(root),
+                        Arg::Trusted => accum.4 = true,
+                        Arg::Pure => accum.5 = true,
+                    }
+                    accum
+                },
+            );
 
         let ident = LazyCell::new(|| ident.to_string());
         Self {
@@ -180,6 +219,8 @@ impl Config {
                 .unwrap_or_else(|| Ident::new(&ident.to_case(Case::Pascal), Span::call_site())),
             doc,
             garguile_root: garguile_root.unwrap_or(parse_quote! { ::garguile }),
+            trusted,
+            pure,
         }
     }
 }
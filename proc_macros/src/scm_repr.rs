@@ -0,0 +1,483 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+use {
+    crate::get_last_attr,
+    convert_case::{Case, Casing},
+    proc_macro2::{Span, TokenStream},
+    quote::quote,
+    syn::{
+        Attribute, Data, DataEnum, DataStruct, Expr, ExprLit, Fields, FieldsNamed, GenericParam,
+        Generics, Ident, Lifetime, Lit, LitStr, Path, Type, spanned::Spanned,
+    },
+};
+
+/// How a type is represented in scheme, set with `#[scm_repr = "..."]`.
+pub enum ScmRepr {
+    /// Opaque foreign object, which is the default.
+    ForeignObject,
+    /// Record created by deriving `Record`.
+    Record,
+    /// Symbols for unit variants and tagged lists for variants with fields.
+    Enum,
+    /// Collection keyed by field names.
+    Keyed(Keyed),
+}
+impl ScmRepr {
+    pub fn new(attrs: &[Attribute]) -> Result<Self, syn::Error> {
+        get_last_attr(
+            attrs,
+            "scm_repr",
+            |expr| match expr {
+                Expr::Lit(ExprLit {
+                    lit: Lit::Str(repr),
+                    ..
+                }) => Ok(repr),
+                expr => Err(syn::Error::new(
+                    expr.span(),
+                    "expected string literal: `scm_repr = \"record\"`",
+                )),
+            },
+            LitStr::new("foreign_object", Span::call_site()),
+        )
+        .and_then(|repr| match repr.value().as_str() {
+            "foreign_object" => Ok(Self::ForeignObject),
+            "record" => Ok(Self::Record),
+            "enum" => Ok(Self::Enum),
+            "alist" => Ok(Self::Keyed(Keyed::Alist)),
+            "plist" => Ok(Self::Keyed(Keyed::Plist)),
+            "hash_table" => Ok(Self::Keyed(Keyed::HashTable)),
+            _ => Err(syn::Error::new(
+                repr.span(),
+                "expected one of `foreign_object`, `record`, `enum`, `alist`, `plist` or `hash_table`",
+            )),
+        })
+    }
+}
+
+/// Collection that a struct with a [ScmRepr::Keyed] representation is converted into.
+#[derive(Clone, Copy)]
+pub enum Keyed {
+    /// List of `(key . value)` pairs with symbol keys.
+    Alist,
+    /// List alternating between keyword keys and values.
+    Plist,
+    /// `equal?` hash table with symbol keys.
+    HashTable,
+}
+
+/// Get the named fields of a struct.
+pub fn named_fields(ident: &Ident, data: &Data) -> Result<Vec<(Ident, Type)>, syn::Error> {
+    match data {
+        Data::Struct(DataStruct {
+            fields: Fields::Named(FieldsNamed { named, .. }),
+            ..
+        }) => Ok(named
+            .iter()
+            .map(|field| (field.ident.clone().unwrap(), field.ty.clone()))
+            .collect()),
+        _ => Err(syn::Error::new(
+            ident.span(),
+            "expected a struct with named fields",
+        )),
+    }
+}
+
+/// Reject type and const parameters, since the record type and constructor are cached in statics that every instantiation would share.
+pub fn record_generics(generics: &Generics) -> Result<(), syn::Error> {
+    generics
+        .params
+        .iter()
+        .find(|param| !matches!(param, GenericParam::Lifetime(_)))
+        .map_or(Ok(()), |param| {
+            Err(syn::Error::new(
+                param.span(),
+                "`Record` cannot be derived for structs with type or const parameters, since every instantiation would share one record type",
+            ))
+        })
+}
+
+pub fn record(garguile_root: &Path, ident: &Ident, fields: &[(Ident, Type)]) -> TokenStream {
+    let name = ident.to_string().to_case(Case::Kebab);
+    let field_names = fields
+        .iter()
+        .map(|(field, _)| field.to_string().to_case(Case::Kebab));
+
+    quote! {
+        const NAME: &'static str = #name;
+        const FIELDS: &'static [&'static str] = &[#(#field_names),*];
+
+        unsafe fn get_or_create_type() -> #garguile_root::sys::SCM {
+            static RECORD_TYPE: ::std::sync::LazyLock<::std::sync::atomic::AtomicPtr<#garguile_root::sys::scm_unused_struct>>
+                = ::std::sync::LazyLock::new(|| unsafe {
+                    #garguile_root::record::make_record_type(
+                        <#ident as #garguile_root::record::Record>::NAME,
+                        <#ident as #garguile_root::record::Record>::FIELDS,
+                    )
+                }.into());
+
+            RECORD_TYPE.load(::std::sync::atomic::Ordering::Acquire)
+        }
+        unsafe fn constructor() -> #garguile_root::sys::SCM {
+            static CONSTRUCTOR: ::std::sync::LazyLock<::std::sync::atomic::AtomicPtr<#garguile_root::sys::scm_unused_struct>>
+                = ::std::sync::LazyLock::new(|| unsafe {
+                    #garguile_root::record::record_constructor(<#ident as #garguile_root::record::Record>::get_or_create_type())
+                }.into());
+
+            CONSTRUCTOR.load(::std::sync::atomic::Ordering::Acquire)
+        }
+    }
+}
+
+pub fn record_to_scm(garguile_root: &Path, gm: &Lifetime, fields: &[(Ident, Type)]) -> TokenStream {
+    let idents = fields.iter().map(|(ident, _)| ident).collect::<Vec<_>>();
+    let len = fields.len();
+
+    quote! {
+        fn to_scm(self, guile: &#gm #garguile_root::Guile) -> #garguile_root::scm::Scm<#gm> {
+            let Self { #(#idents),* } = self;
+            let mut fields: [#garguile_root::sys::SCM; #len] = [#(#garguile_root::reference::ReprScm::as_ptr(&#garguile_root::scm::ToScm::to_scm(#idents, guile))),*];
+            #garguile_root::scm::Scm::from_ptr(
+                unsafe {
+                    #garguile_root::sys::scm_call_n(
+                        <Self as #garguile_root::record::Record>::constructor(),
+                        fields.as_mut_ptr(),
+                        #len,
+                    )
+                },
+                guile,
+            )
+        }
+    }
+}
+
+pub fn record_try_from_scm(
+    garguile_root: &Path,
+    gm: &Lifetime,
+    fields: &[(Ident, Type)],
+) -> TokenStream {
+    let idents = fields.iter().map(|(ident, _)| ident);
+    let tys = fields.iter().map(|(_, ty)| ty).collect::<Vec<_>>();
+    let idxs = (0..fields.len()).collect::<Vec<_>>();
+
+    quote! {
+        fn predicate(scm: &#garguile_root::scm::Scm<#gm>, guile: &#gm #garguile_root::Guile) -> bool {
+            let ptr = #garguile_root::reference::ReprScm::as_ptr(scm);
+            let is_a = unsafe { #garguile_root::record::is_a(ptr, <Self as #garguile_root::record::Record>::get_or_create_type()) };
+            is_a #(&& <#tys as #garguile_root::scm::TryFromScm>::predicate(
+                    &#garguile_root::scm::Scm::from_ptr(unsafe { #garguile_root::record::field(ptr, #idxs) }, guile),
+                    guile,
+                ))*
+        }
+
+        unsafe fn from_scm_unchecked(scm: #garguile_root::scm::Scm<#gm>, guile: &#gm #garguile_root::Guile) -> Self {
+            let ptr = #garguile_root::reference::ReprScm::as_ptr(&scm);
+            Self {
+                #(#idents: unsafe {
+                    <#tys as #garguile_root::scm::TryFromScm>::from_scm_unchecked(
+                        #garguile_root::scm::Scm::from_ptr(#garguile_root::record::field(ptr, #idxs), guile),
+                        guile,
+                    )
+                },)*
+            }
+        }
+    }
+}
+
+/// Get the variants of an enum with the types of their fields in order.
+pub fn variants(ident: &Ident, data: &Data) -> Result<Vec<(Ident, Fields)>, syn::Error> {
+    match data {
+        Data::Enum(DataEnum { variants, .. }) if variants.is_empty() => Err(syn::Error::new(
+            ident.span(),
+            "`scm_repr = \"enum\"` needs at least one variant",
+        )),
+        Data::Enum(DataEnum { variants, .. }) => Ok(variants
+            .iter()
+            .map(|variant| (variant.ident.clone(), variant.fields.clone()))
+            .collect()),
+        _ => Err(syn::Error::new(
+            ident.span(),
+            "`scm_repr = \"enum\"` can only be used on enums",
+        )),
+    }
+}
+
+/// Idents that the fields of a variant are bound to and the pattern that binds them.
+fn variant_pattern(variant: &Ident, fields: &Fields) -> (Vec<Ident>, TokenStream) {
+    let bindings = (0..fields.len())
+        .map(|i| Ident::new(&format!("field_{i}"), Span::call_site()))
+        .collect::<Vec<_>>();
+    let pattern = match fields {
+        Fields::Named(FieldsNamed { named, .. }) => {
+            let names = named.iter().map(|field| field.ident.as_ref().unwrap());
+            quote! { Self::#variant { #(#names: #bindings),* } }
+        }
+        Fields::Unnamed(_) => quote! { Self::#variant(#(#bindings),*) },
+        Fields::Unit => quote! { Self::#variant },
+    };
+
+    (bindings, pattern)
+}
+
+/// Function returning the interned tag of every variant, which is never garbage collected.
+///
+/// This is emitted next to the impl, so its methods share one table.
+pub fn enum_symbols(garguile_root: &Path, variants: &[(Ident, Fields)]) -> TokenStream {
+    let len = variants.len();
+    let names = variants
+        .iter()
+        .map(|(variant, _)| variant.to_string().to_case(Case::Kebab));
+
+    quote! {
+        fn symbols() -> &'static [::std::sync::atomic::AtomicPtr<#garguile_root::sys::scm_unused_struct>; #len] {
+            static SYMBOLS: ::std::sync::LazyLock<[::std::sync::atomic::AtomicPtr<#garguile_root::sys::scm_unused_struct>; #len]>
+                = ::std::sync::LazyLock::new(|| [#(unsafe { #garguile_root::variant::make_symbol(#names) }.into()),*]);
+
+            &SYMBOLS
+        }
+    }
+}
+
+/// Tokens that load the tag of every variant from the table of [enum_symbols] bound to `symbols`.
+fn variant_tags(variants: &[(Ident, Fields)]) -> Vec<TokenStream> {
+    (0..variants.len())
+        .map(|i| quote! { symbols[#i].load(::std::sync::atomic::Ordering::Acquire) })
+        .collect()
+}
+
+pub fn enum_to_scm(
+    garguile_root: &Path,
+    gm: &Lifetime,
+    variants: &[(Ident, Fields)],
+) -> TokenStream {
+    let arms = variants
+        .iter()
+        .zip(variant_tags(variants))
+        .map(|((variant, fields), tag)| {
+            let (bindings, pattern) = variant_pattern(variant, fields);
+
+            if fields.is_empty() {
+                quote! { #pattern => #tag, }
+            } else {
+                quote! {
+                    #pattern => unsafe {
+                        #garguile_root::sys::scm_list_n(
+                            #tag,
+                            #(#garguile_root::reference::ReprScm::as_ptr(&#garguile_root::scm::ToScm::to_scm(#bindings, guile)),)*
+                            #garguile_root::sys::SCM_UNDEFINED,
+                        )
+                    },
+                }
+            }
+        });
+
+    quote! {
+        fn to_scm(self, guile: &#gm #garguile_root::Guile) -> #garguile_root::scm::Scm<#gm> {
+            let symbols = symbols();
+            #garguile_root::scm::Scm::from_ptr(
+                match self {
+                    #(#arms)*
+                },
+                guile,
+            )
+        }
+    }
+}
+
+pub fn enum_try_from_scm(
+    garguile_root: &Path,
+    gm: &Lifetime,
+    variants: &[(Ident, Fields)],
+) -> TokenStream {
+    let tags = variant_tags(variants);
+    // unit variants never convert fields
+    let guile = if variants.iter().all(|(_, fields)| fields.is_empty()) {
+        quote! { _ }
+    } else {
+        quote! { guile }
+    };
+
+    let predicates = variants.iter().zip(&tags).map(|((_, fields), tag)| {
+        if fields.is_empty() {
+            quote! { ptr == #tag }
+        } else {
+            let len = fields.len();
+            let tys = fields.iter().map(|field| &field.ty);
+            let idxs = 0..len;
+
+            quote! {
+                unsafe { #garguile_root::variant::fields::<#len>(ptr, #tag) }
+                    .is_some_and(|fields| true #(&& <#tys as #garguile_root::scm::TryFromScm>::predicate(
+                        &#garguile_root::scm::Scm::from_ptr(fields[#idxs], guile),
+                        guile,
+                    ))*)
+            }
+        }
+    });
+    let conversions = variants.iter().zip(&tags).map(|((variant, fields), tag)| {
+        let (bindings, pattern) = variant_pattern(variant, fields);
+        if fields.is_empty() {
+            quote! {
+                if ptr == #tag {
+                    return #pattern;
+                }
+            }
+        } else {
+            let len = fields.len();
+            let tys = fields.iter().map(|field| &field.ty);
+
+            quote! {
+                if let ::std::option::Option::Some([#(#bindings),*]) = unsafe { #garguile_root::variant::fields::<#len>(ptr, #tag) } {
+                    #(let #bindings = unsafe {
+                        <#tys as #garguile_root::scm::TryFromScm>::from_scm_unchecked(
+                            #garguile_root::scm::Scm::from_ptr(#bindings, guile),
+                            guile,
+                        )
+                    };)*
+                    return #pattern;
+                }
+            }
+        }
+    });
+
+    quote! {
+        fn predicate(scm: &#garguile_root::scm::Scm<#gm>, #guile: &#gm #garguile_root::Guile) -> bool {
+            let symbols = symbols();
+            let ptr = #garguile_root::reference::ReprScm::as_ptr(scm);
+            false #(|| #predicates)*
+        }
+
+        unsafe fn from_scm_unchecked(scm: #garguile_root::scm::Scm<#gm>, #guile: &#gm #garguile_root::Guile) -> Self {
+            let symbols = symbols();
+            let ptr = #garguile_root::reference::ReprScm::as_ptr(&scm);
+            #(#conversions)*
+            ::std::unreachable!("`predicate` should have rejected this object")
+        }
+    }
+}
+
+/// Function returning the interned key of every field, which are never garbage collected.
+///
+/// This is emitted next to the impl, so its methods share one set.
+pub fn keyed_keys(garguile_root: &Path, keyed: Keyed, fields: &[(Ident, Type)]) -> TokenStream {
+    let len = fields.len();
+    let names = fields
+        .iter()
+        .map(|(field, _)| field.to_string().to_case(Case::Kebab));
+    let new = match keyed {
+        Keyed::Alist | Keyed::HashTable => quote! { new },
+        Keyed::Plist => quote! { keywords },
+    };
+
+    quote! {
+        fn keys() -> &'static #garguile_root::alist::Keys<#len> {
+            static KEYS: ::std::sync::LazyLock<#garguile_root::alist::Keys<#len>>
+                = ::std::sync::LazyLock::new(|| unsafe { #garguile_root::alist::Keys::#new([#(#names),*]) });
+
+            &KEYS
+        }
+    }
+}
+
+pub fn keyed_to_scm(
+    garguile_root: &Path,
+    gm: &Lifetime,
+    keyed: Keyed,
+    fields: &[(Ident, Type)],
+) -> TokenStream {
+    let idents = fields.iter().map(|(ident, _)| ident).collect::<Vec<_>>();
+    let idxs = 0..fields.len();
+    let len = fields.len();
+    let keys = (!fields.is_empty()).then(|| quote! { let keys = keys(); });
+    let values = idents.iter().map(|ident| {
+        quote! { #garguile_root::reference::ReprScm::as_ptr(&#garguile_root::scm::ToScm::to_scm(#ident, guile)) }
+    });
+    let scm = match keyed {
+        Keyed::Alist => quote! {
+            #garguile_root::sys::scm_list_n(
+                #(#garguile_root::sys::scm_cons(keys.get(#idxs), #values),)*
+                #garguile_root::sys::SCM_UNDEFINED,
+            )
+        },
+        Keyed::Plist => quote! {
+            #garguile_root::sys::scm_list_n(
+                #(keys.get(#idxs), #values,)*
+                #garguile_root::sys::SCM_UNDEFINED,
+            )
+        },
+        Keyed::HashTable => quote! {
+            {
+                let table = #garguile_root::sys::scm_make_hash_table(
+                    #garguile_root::reference::ReprScm::as_ptr(&#garguile_root::scm::ToScm::to_scm(#len, guile)),
+                );
+                #(#garguile_root::sys::scm_hash_set_x(table, keys.get(#idxs), #values);)*
+                table
+            }
+        },
+    };
+
+    quote! {
+        fn to_scm(self, guile: &#gm #garguile_root::Guile) -> #garguile_root::scm::Scm<#gm> {
+            #keys
+            let Self { #(#idents),* } = self;
+            #garguile_root::scm::Scm::from_ptr(unsafe { #scm }, guile)
+        }
+    }
+}
+
+pub fn keyed_try_from_scm(
+    garguile_root: &Path,
+    gm: &Lifetime,
+    keyed: Keyed,
+    fields: &[(Ident, Type)],
+) -> TokenStream {
+    let idents = fields.iter().map(|(ident, _)| ident);
+    let tys = fields.iter().map(|(_, ty)| ty).collect::<Vec<_>>();
+    let idxs = (0..fields.len()).collect::<Vec<_>>();
+    // structs without fields only check the shape of the object
+    let (guile, values) = if fields.is_empty() {
+        (quote! { _ }, quote! { _ })
+    } else {
+        (quote! { guile }, quote! { fields })
+    };
+    let decode = match keyed {
+        Keyed::Alist => quote! { decode },
+        Keyed::Plist => quote! { decode_plist },
+        Keyed::HashTable => quote! { decode_hash_table },
+    };
+
+    quote! {
+        fn predicate(scm: &#garguile_root::scm::Scm<#gm>, #guile: &#gm #garguile_root::Guile) -> bool {
+            unsafe { keys().#decode(#garguile_root::reference::ReprScm::as_ptr(scm)) }
+                .is_some_and(|#values| true #(&& <#tys as #garguile_root::scm::TryFromScm>::predicate(
+                    &#garguile_root::scm::Scm::from_ptr(fields[#idxs], guile),
+                    guile,
+                ))*)
+        }
+
+        unsafe fn from_scm_unchecked(scm: #garguile_root::scm::Scm<#gm>, #guile: &#gm #garguile_root::Guile) -> Self {
+            let #values = unsafe { keys().#decode(#garguile_root::reference::ReprScm::as_ptr(&scm)) }
+                .expect("`predicate` should have rejected this object");
+            Self {
+                #(#idents: unsafe {
+                    <#tys as #garguile_root::scm::TryFromScm>::from_scm_unchecked(
+                        #garguile_root::scm::Scm::from_ptr(fields[#idxs], guile),
+                        guile,
+                    )
+                },)*
+            }
+        }
+    }
+}
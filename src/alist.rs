@@ -0,0 +1,252 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Rust structs represented as association lists, property lists or hash tables.
+//!
+//! Deriving [ToScm][crate::scm::ToScm] and [TryFromScm][crate::scm::TryFromScm] with `#[scm_repr = "alist"]` converts a struct into a list of `(key . value)` pairs, where each key is a field name in kebab case.
+//! Decoding walks the list once and looks up each key by its address, so it takes `O(n log k)` for `n` pairs and `k` fields instead of an `assq` for every field.
+//! Like `assq`, the first pair with a key wins, keys that are not fields are ignored, and missing keys are unbound, which only [Option] fields accept.
+//!
+//! `#[scm_repr = "plist"]` uses a list alternating between keywords and values like `(#:width 80 #:height 24)` instead, and `#[scm_repr = "hash_table"]` uses an `equal?` hash table with symbol keys.
+//! Hash tables are decoded by walking their buckets once, so they are accepted whichever hash procedures created them.
+//!
+//! # Examples
+//!
+//! ```
+//! # use garguile::{scm::{ToScm, TryFromScm}, string::String, with_guile};
+//! #[derive(Clone, Copy, Debug, PartialEq, TryFromScm)]
+//! #[scm_repr = "alist"]
+//! struct Config {
+//!     width: i32,
+//!     height: Option<i32>,
+//!     full_screen: bool,
+//! }
+//! #[derive(Clone, Copy, Debug, PartialEq, ToScm, TryFromScm)]
+//! #[scm_repr = "alist"]
+//! struct Size {
+//!     width: i32,
+//!     height: i32,
+//! }
+//! #[derive(Clone, Copy, Debug, PartialEq, ToScm, TryFromScm)]
+//! #[scm_repr = "plist"]
+//! struct Margins {
+//!     top: i32,
+//!     bottom: i32,
+//! }
+//! #[derive(Clone, Copy, Debug, PartialEq, ToScm, TryFromScm)]
+//! #[scm_repr = "hash_table"]
+//! struct Cursor {
+//!     line: i32,
+//!     column: i32,
+//! }
+//! # #[cfg(not(miri))]
+//! with_guile(|guile| {
+//!     assert_eq!(
+//!         unsafe { guile.eval::<Config>(&String::from_str("'((full-screen . #t) (width . 80) (vsync . #f) (width . 40))", guile)) },
+//!         Ok(Config { width: 80, height: None, full_screen: true }),
+//!     );
+//!     assert!(unsafe { guile.eval::<Config>(&String::from_str("'((width . 80))", guile)) }.is_err());
+//!     assert!(unsafe { guile.eval::<Config>(&String::from_str("'((width . 80) (full-screen . 1))", guile)) }.is_err());
+//!     assert!(unsafe { guile.eval::<Config>(&String::from_str("'((width . 80) full-screen)", guile)) }.is_err());
+//!
+//!     let size = Size { width: 80, height: 24 };
+//!     assert_eq!(Size::try_from_scm(size.to_scm(guile), guile), Ok(size));
+//!
+//!     assert_eq!(
+//!         unsafe { guile.eval::<Margins>(&String::from_str("'(#:top 1 #:bottom 2 #:top 3)", guile)) },
+//!         Ok(Margins { top: 1, bottom: 2 }),
+//!     );
+//!     assert!(unsafe { guile.eval::<Margins>(&String::from_str("'(#:top 1 #:bottom)", guile)) }.is_err());
+//!     let margins = Margins { top: 4, bottom: 8 };
+//!     assert_eq!(Margins::try_from_scm(margins.to_scm(guile), guile), Ok(margins));
+//!
+//!     assert_eq!(
+//!         unsafe { guile.eval::<Cursor>(&String::from_str("(let ((table (make-hash-table))) (hashq-set! table 'line 3) (hashq-set! table 'column 7) table)", guile)) },
+//!         Ok(Cursor { line: 3, column: 7 }),
+//!     );
+//!     assert!(unsafe { guile.eval::<Cursor>(&String::from_str("'((line . 3) (column . 7))", guile)) }.is_err());
+//!     let cursor = Cursor { line: 1, column: 0 };
+//!     assert_eq!(Cursor::try_from_scm(cursor.to_scm(guile), guile), Ok(cursor));
+//! }).unwrap();
+//! ```
+
+use crate::{
+    Guile,
+    reference::ReprScm,
+    symbol::Symbol,
+    sys::{
+        SCM, SCM_EOL, SCM_HASHTABLE_P, SCM_HASHTABLE_VECTOR, SCM_UNDEFINED, scm_c_vector_length,
+        scm_c_vector_ref, scm_car, scm_cdr, scm_gc_protect_object, scm_is_pair,
+        scm_symbol_to_keyword,
+    },
+    utils::c_predicate,
+};
+
+/// Interned keys of a keyed representation, which are never garbage collected.
+#[doc(hidden)]
+pub struct Keys<const N: usize> {
+    /// Address of the key of each field in declaration order.
+    keys: [usize; N],
+    /// Pairs of key addresses and field indexes sorted by address.
+    sorted: [(usize, usize); N],
+}
+impl<const N: usize> Keys<N> {
+    /// Intern the keys as symbols.
+    ///
+    /// # Safety
+    ///
+    /// You must be in guile mode.
+    pub unsafe fn new(names: [&str; N]) -> Self {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        unsafe { Self::from_keys(names.map(|name| Symbol::from_str(name, guile).as_ptr())) }
+    }
+
+    /// Intern the keys as keywords.
+    ///
+    /// # Safety
+    ///
+    /// You must be in guile mode.
+    pub unsafe fn keywords(names: [&str; N]) -> Self {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        unsafe {
+            Self::from_keys(
+                names.map(|name| scm_symbol_to_keyword(Symbol::from_str(name, guile).as_ptr())),
+            )
+        }
+    }
+
+    /// # Safety
+    ///
+    /// You must be in guile mode.
+    unsafe fn from_keys(keys: [SCM; N]) -> Self {
+        let keys = keys.map(|key| (unsafe { scm_gc_protect_object(key) }) as usize);
+        let mut sorted: [(usize, usize); N] = std::array::from_fn(|i| (keys[i], i));
+        sorted.sort_unstable();
+
+        Self { keys, sorted }
+    }
+
+    /// Get the key of field `i`.
+    pub fn get(&self, i: usize) -> SCM {
+        self.keys[i] as SCM
+    }
+
+    /// Set the field of `key` to `value` unless it was already found.
+    fn set(&self, key: SCM, value: SCM, fields: &mut [SCM; N], found: &mut [bool; N]) {
+        if let Ok(i) = self
+            .sorted
+            .binary_search_by_key(&(key as usize), |(key, _)| *key)
+        {
+            let i = self.sorted[i].1;
+            if !found[i] {
+                found[i] = true;
+                fields[i] = value;
+            }
+        }
+    }
+
+    /// Collect the values of a list of pairs into `fields`.
+    ///
+    /// Returns whether `alist` is a proper list of pairs.
+    ///
+    /// # Safety
+    ///
+    /// You must be in guile mode.
+    unsafe fn decode_pairs(
+        &self,
+        alist: SCM,
+        fields: &mut [SCM; N],
+        found: &mut [bool; N],
+    ) -> bool {
+        let mut rest = alist;
+        while c_predicate(unsafe { scm_is_pair(rest) }) {
+            let entry = unsafe { scm_car(rest) };
+            if !c_predicate(unsafe { scm_is_pair(entry) }) {
+                return false;
+            }
+
+            self.set(
+                unsafe { scm_car(entry) },
+                unsafe { scm_cdr(entry) },
+                fields,
+                found,
+            );
+            rest = unsafe { scm_cdr(rest) };
+        }
+
+        rest == unsafe { SCM_EOL }
+    }
+
+    /// Collect the value of every key in one pass, leaving missing keys unbound.
+    ///
+    /// Returns [None] if `alist` is not a proper list of pairs.
+    ///
+    /// # Safety
+    ///
+    /// You must be in guile mode.
+    pub unsafe fn decode(&self, alist: SCM) -> Option<[SCM; N]> {
+        let mut fields = [unsafe { SCM_UNDEFINED }; N];
+        let mut found = [false; N];
+        unsafe { self.decode_pairs(alist, &mut fields, &mut found) }.then_some(fields)
+    }
+
+    /// Collect the value of every key of a property list in one pass, leaving missing keys unbound.
+    ///
+    /// Returns [None] if `plist` is not a proper list with an even length.
+    ///
+    /// # Safety
+    ///
+    /// You must be in guile mode.
+    pub unsafe fn decode_plist(&self, plist: SCM) -> Option<[SCM; N]> {
+        let mut fields = [unsafe { SCM_UNDEFINED }; N];
+        let mut found = [false; N];
+        let mut rest = plist;
+        while c_predicate(unsafe { scm_is_pair(rest) }) {
+            let key = unsafe { scm_car(rest) };
+            rest = unsafe { scm_cdr(rest) };
+            if !c_predicate(unsafe { scm_is_pair(rest) }) {
+                return None;
+            }
+
+            self.set(key, unsafe { scm_car(rest) }, &mut fields, &mut found);
+            rest = unsafe { scm_cdr(rest) };
+        }
+
+        (rest == unsafe { SCM_EOL }).then_some(fields)
+    }
+
+    /// Collect the value of every key of a hash table by walking its buckets once, leaving missing keys unbound.
+    ///
+    /// This works for tables created by any of the `hash`, `hashq` and `hashv` procedures since keys are compared by address.
+    /// Returns [None] if `table` is not a hash table.
+    ///
+    /// # Safety
+    ///
+    /// You must be in guile mode.
+    pub unsafe fn decode_hash_table(&self, table: SCM) -> Option<[SCM; N]> {
+        if !c_predicate(unsafe { SCM_HASHTABLE_P(table) }) {
+            return None;
+        }
+
+        let mut fields = [unsafe { SCM_UNDEFINED }; N];
+        let mut found = [false; N];
+        let buckets = unsafe { SCM_HASHTABLE_VECTOR(table) };
+        (0..unsafe { scm_c_vector_length(buckets) })
+            .all(|i| unsafe {
+                self.decode_pairs(scm_c_vector_ref(buckets, i), &mut fields, &mut found)
+            })
+            .then_some(fields)
+    }
+}
@@ -20,4 +20,5 @@ pub mod char_set;
 pub mod hash_map;
 pub mod list;
 pub mod pair;
+pub mod shared_map;
 pub mod vector;
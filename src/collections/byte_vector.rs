@@ -22,7 +22,7 @@ use {
         Guile,
         alloc::CAllocator,
         collections::list::List,
-        reference::ReprScm,
+        reference::{KeepAlive, ReprScm},
         scm::{Scm, ToScm, TryFromScm},
         sys::{SCM, scm_array_handle_release, scm_t_array_handle},
         utils::scm_predicate,
@@ -329,6 +329,7 @@ where
             ptr,
             len: NonZeroUsize::new(len),
             step,
+            _keep_alive: KeepAlive::new(&self.scm),
             _marker: PhantomData,
         }
     }
@@ -363,6 +364,7 @@ where
             ptr,
             len: NonZeroUsize::new(len),
             step,
+            _keep_alive: KeepAlive::new(&self.scm),
             _marker: PhantomData,
         }
     }
@@ -416,6 +418,7 @@ where
             len: NonZeroUsize::new(len),
             step,
             ptr,
+            _keep_alive: KeepAlive::new(&self.scm),
             _marker: PhantomData,
         }
     }
@@ -480,6 +483,7 @@ where
     ptr: *const T,
     len: Option<NonZeroUsize>,
     step: isize,
+    _keep_alive: KeepAlive<'gm>,
     _marker: PhantomData<&'gm T>,
 }
 impl<T> Drop for IntoIter<'_, T>
@@ -544,6 +548,7 @@ where
     ptr: *const T,
     len: Option<NonZeroUsize>,
     step: isize,
+    _keep_alive: KeepAlive<'gm>,
     _marker: PhantomData<&'a &'gm T>,
 }
 impl<T> Drop for Iter<'_, '_, T>
@@ -608,6 +613,7 @@ where
     ptr: *mut T,
     len: Option<NonZeroUsize>,
     step: isize,
+    _keep_alive: KeepAlive<'gm>,
     _marker: PhantomData<&'a &'gm T>,
 }
 impl<T> Drop for IterMut<'_, '_, T>
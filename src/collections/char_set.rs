@@ -24,12 +24,12 @@ use {
         string::String,
         sys::{
             SCM_UNDEFINED, scm_char_set_contains_p, scm_char_set_cursor, scm_char_set_cursor_next,
-            scm_char_set_p, scm_char_set_ref, scm_end_of_char_set_p, scm_list_to_char_set,
-            scm_string_to_char_set, scm_to_char_set,
+            scm_char_set_p, scm_char_set_ref, scm_char_set_to_string, scm_end_of_char_set_p,
+            scm_list_to_char_set, scm_string_to_char_set, scm_to_char_set,
         },
         utils::scm_predicate,
     },
-    std::{borrow::Cow, ffi::CStr},
+    std::{borrow::Cow, ffi::CStr, ops::RangeInclusive},
 };
 
 /// Character hash sets.
@@ -80,6 +80,32 @@ impl<'gm> CharSet<'gm> {
             char_set: self,
         }
     }
+
+    /// Copy the character set into rust memory so that lookups do not need to call into guile.
+    ///
+    /// Changes to the character set afterwards are not reflected in the frozen copy.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{list, collections::char_set::CharSet, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let abc = CharSet::from(list!(guile, 'a', 'b', 'c')).freeze();
+    ///     assert!(abc.contains('a'));
+    ///     assert!(!abc.contains('d'));
+    /// }).unwrap();
+    /// ```
+    pub fn freeze(&self) -> FrozenCharSet {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        let string = unsafe {
+            String::from_scm_unchecked(
+                Scm::from_ptr(scm_char_set_to_string(self.0.as_ptr()), guile),
+                guile,
+            )
+        };
+        string.as_string().chars().collect()
+    }
 }
 impl<'gm> From<char> for CharSet<'gm> {
     fn from(ch: char) -> Self {
@@ -153,6 +179,183 @@ impl Iterator for Iter<'_, '_> {
     }
 }
 
+/// Character set stored in rust memory.
+///
+/// Characters below 256 are looked up in a bitmap and the rest are binary searched in a sorted list of ranges.
+///
+/// This is created with [CharSet::freeze] or [FromIterator].
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct FrozenCharSet {
+    latin1: [u64; 4],
+    ranges: Box<[RangeInclusive<char>]>,
+}
+impl FrozenCharSet {
+    const HIGH_BITS: u64 = u64::from_ne_bytes([0x80; 8]);
+
+    /// Check if the character set contains a character.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::collections::char_set::FrozenCharSet;
+    /// let set = FrozenCharSet::from_iter("aλ".chars());
+    /// assert!(set.contains('a'));
+    /// assert!(set.contains('λ'));
+    /// assert!(!set.contains('b'));
+    /// ```
+    pub fn contains(&self, ch: char) -> bool {
+        match u8::try_from(ch) {
+            Ok(byte) => self.contains_latin1(byte),
+            Err(_) => self
+                .ranges
+                .binary_search_by(|range| {
+                    if *range.end() < ch {
+                        std::cmp::Ordering::Less
+                    } else if *range.start() > ch {
+                        std::cmp::Ordering::Greater
+                    } else {
+                        std::cmp::Ordering::Equal
+                    }
+                })
+                .is_ok(),
+        }
+    }
+    fn contains_latin1(&self, byte: u8) -> bool {
+        self.latin1[usize::from(byte >> 6)] & (1 << (byte & 63)) != 0
+    }
+
+    /// Get the 8 bytes at `i` if they are all ascii.
+    fn ascii_chunk(bytes: &[u8], i: usize) -> Option<[u8; 8]> {
+        let chunk = <[u8; 8]>::try_from(bytes.get(i..i + 8)?).unwrap();
+        (u64::from_ne_bytes(chunk) & Self::HIGH_BITS == 0).then_some(chunk)
+    }
+    /// Get a mask with bit `n` set if the ascii byte `chunk[n]` is in the set.
+    fn ascii_matches(&self, chunk: [u8; 8]) -> u8 {
+        if self.latin1[..2] == [0; 2] {
+            return 0;
+        }
+        // every byte is looked up without branching so that only the whole word is tested
+        chunk.into_iter().enumerate().fold(0, |mask, (n, byte)| {
+            mask | (u8::from(self.contains_latin1(byte)) << n)
+        })
+    }
+    /// Check if the character starting at byte `i` of `haystack` is in the set and get its length.
+    ///
+    /// # Safety
+    ///
+    /// `i` must be the start of a character in `haystack`.
+    unsafe fn char_at(&self, haystack: &str, i: usize) -> (bool, usize) {
+        let byte = haystack.as_bytes()[i];
+        if byte.is_ascii() {
+            (self.contains_latin1(byte), 1)
+        } else {
+            let ch = unsafe { haystack.get_unchecked(i..) }
+                .chars()
+                .next()
+                .unwrap();
+            (self.contains(ch), ch.len_utf8())
+        }
+    }
+
+    /// Get the byte index of the first character in `haystack` that is in the set.
+    ///
+    /// Ascii text is checked eight bytes at a time by looking each byte up in the bitmap and testing the resulting mask once.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::collections::char_set::FrozenCharSet;
+    /// let digits = FrozenCharSet::from_iter('0'..='9');
+    /// assert_eq!(digits.scan_until("abc123"), Some(3));
+    /// assert_eq!(digits.scan_until("abcdefghijk9"), Some(11));
+    /// assert_eq!(digits.scan_until("λ1"), Some(2));
+    /// assert_eq!(digits.scan_until("abc"), None);
+    /// ```
+    pub fn scan_until(&self, haystack: &str) -> Option<usize> {
+        let bytes = haystack.as_bytes();
+        let mut i = 0;
+
+        while i < bytes.len() {
+            if let Some(chunk) = Self::ascii_chunk(bytes, i) {
+                match self.ascii_matches(chunk) {
+                    0 => i += 8,
+                    mask => return Some(i + mask.trailing_zeros() as usize),
+                }
+                continue;
+            }
+
+            // SAFETY: `i` is only ever advanced by whole characters
+            let (contains, len) = unsafe { self.char_at(haystack, i) };
+            if contains {
+                return Some(i);
+            }
+            i += len;
+        }
+
+        None
+    }
+
+    /// Count the number of characters in `haystack` that are in the set.
+    ///
+    /// Like [Self::scan_until], ascii text is counted eight bytes at a time.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::collections::char_set::FrozenCharSet;
+    /// let vowels = FrozenCharSet::from_iter("aeiou".chars());
+    /// assert_eq!(vowels.count_in("the quick brown fox"), 5);
+    /// ```
+    pub fn count_in(&self, haystack: &str) -> usize {
+        let bytes = haystack.as_bytes();
+        let mut count = 0;
+        let mut i = 0;
+
+        while i < bytes.len() {
+            if let Some(chunk) = Self::ascii_chunk(bytes, i) {
+                count += self.ascii_matches(chunk).count_ones() as usize;
+                i += 8;
+                continue;
+            }
+
+            // SAFETY: `i` is only ever advanced by whole characters
+            let (contains, len) = unsafe { self.char_at(haystack, i) };
+            count += usize::from(contains);
+            i += len;
+        }
+
+        count
+    }
+}
+impl FromIterator<char> for FrozenCharSet {
+    fn from_iter<I>(iter: I) -> Self
+    where
+        I: IntoIterator<Item = char>,
+    {
+        let mut latin1 = [0; 4];
+        let mut rest = Vec::new();
+        iter.into_iter().for_each(|ch| match u8::try_from(ch) {
+            Ok(byte) => latin1[usize::from(byte >> 6)] |= 1 << (byte & 63),
+            Err(_) => rest.push(ch),
+        });
+        rest.sort_unstable();
+        rest.dedup();
+
+        let mut ranges = Vec::<RangeInclusive<char>>::new();
+        rest.into_iter().for_each(|ch| match ranges.last_mut() {
+            Some(range) if u32::from(*range.end()) + 1 == u32::from(ch) => {
+                *range = *range.start()..=ch
+            }
+            _ => ranges.push(ch..=ch),
+        });
+
+        Self {
+            latin1,
+            ranges: ranges.into_boxed_slice(),
+        }
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use {super::*, crate::with_guile, std::collections::HashSet};
@@ -182,4 +385,54 @@ mod tests {
         })
         .unwrap();
     }
+
+    #[test]
+    fn frozen_char_set() {
+        let set = FrozenCharSet::from_iter("az\u{ff}αβγε".chars());
+        assert_eq!(set.ranges.as_ref(), ['α'..='γ', 'ε'..='ε']);
+        ['a', 'z', '\u{ff}', 'α', 'β', 'γ', 'ε']
+            .into_iter()
+            .for_each(|ch| assert!(set.contains(ch)));
+        ['b', '\u{fe}', 'δ', 'ζ', '\u{10ffff}']
+            .into_iter()
+            .for_each(|ch| assert!(!set.contains(ch)));
+
+        let greek = FrozenCharSet::from_iter('α'..='ω');
+        assert_eq!(greek.scan_until("the letter λ"), Some(11));
+        assert_eq!(greek.scan_until("no greek here at all"), None);
+        assert_eq!(greek.count_in("αβ and γ"), 3);
+        assert_eq!(FrozenCharSet::default().scan_until("anything"), None);
+    }
+
+    #[test]
+    fn frozen_char_set_scan() {
+        let set = FrozenCharSet::from_iter("x9λ".chars());
+        let haystack = "abcdefgh9 ijklmnop λ qrstuvwx 99 yz xλx";
+        (0..haystack.len())
+            .filter(|&i| haystack.is_char_boundary(i))
+            .for_each(|i| {
+                let rest = &haystack[i..];
+                assert_eq!(
+                    set.scan_until(rest),
+                    rest.char_indices()
+                        .find(|&(_, ch)| set.contains(ch))
+                        .map(|(i, _)| i)
+                );
+                assert_eq!(
+                    set.count_in(rest),
+                    rest.chars().filter(|&ch| set.contains(ch)).count()
+                );
+            });
+    }
+
+    #[cfg_attr(miri, ignore)]
+    #[test]
+    fn char_set_freeze() {
+        with_guile(|guile| {
+            let set = CharSet::from(String::from_str("asdfλ", guile));
+            let frozen = set.freeze();
+            ('\0'..='\u{3ff}').for_each(|ch| assert_eq!(set.contains(ch), frozen.contains(ch)));
+        })
+        .unwrap();
+    }
 }
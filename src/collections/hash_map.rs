@@ -21,16 +21,27 @@ use {
         collections::pair::Pair,
         reference::{Ref, RefMut, ReprScm},
         scm::{Scm, ToScm, TryFromScm},
+        string::HashedString,
         sys::{
-            SCM, SCM_BOOL_F, SCM_UNDEFINED, scm_c_make_gsubr, scm_cdr, scm_hash_fold,
-            scm_hash_table_p, scm_make_hash_table,
+            SCM, SCM_BOOL_F, SCM_HASHTABLE_N_ITEMS, SCM_HASHTABLE_P, SCM_HASHTABLE_VECTOR,
+            SCM_UNBNDP, SCM_UNDEFINED, scm_array_handle_release, scm_c_make_gsubr, scm_car,
+            scm_cdr, scm_from_uintptr_t, scm_gc_protect_object, scm_hash_clear_x,
+            scm_hashx_create_handle_x, scm_hashx_get_handle, scm_hashx_ref, scm_hashx_remove_x,
+            scm_hashx_set_x, scm_internal_hash_fold, scm_is_pair, scm_make_hash_table,
+            scm_set_cdr_x, scm_string_equal_p, scm_t_array_handle, scm_to_uintptr_t,
+            scm_unused_struct, scm_vector_elements,
         },
-        utils::CowCStrExt,
+        utils::{CowCStrExt, c_predicate, scm_predicate},
     },
     std::{
         borrow::Cow,
         ffi::{CStr, CString, c_void},
+        iter::FusedIterator,
         marker::PhantomData,
+        sync::{
+            LazyLock,
+            atomic::{self, AtomicPtr},
+        },
     },
 };
 
@@ -39,10 +50,12 @@ trait ScmPartialEq {
     const SET: unsafe extern "C" fn(_table: SCM, _key: SCM, _val: SCM) -> SCM;
     /// Remove `key` from `table` and return its pair.
     const REMOVE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM;
+    /// Get the value of `key` in `table` or `dflt` if it doesn't exist.
+    const REF: unsafe extern "C" fn(_table: SCM, _key: SCM, _dflt: SCM) -> SCM;
     /// Get a handle from `key` in `table` or `#f` if it doesn't exist.
     const GET_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM;
-    // /// Get the handle or insert it.
-    // const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM;
+    /// Get the handle from `key` in `table` or insert `init` and return the new handle.
+    const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM;
 }
 
 /// Hash map vtable that uses the `eq?` family.
@@ -52,10 +65,12 @@ impl ScmPartialEq for Eq {
         crate::sys::scm_hashq_set_x;
     const REMOVE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM =
         crate::sys::scm_hashq_remove_x;
+    const REF: unsafe extern "C" fn(_table: SCM, _key: SCM, _dflt: SCM) -> SCM =
+        crate::sys::scm_hashq_ref;
     const GET_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM =
         crate::sys::scm_hashq_get_handle;
-    // const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM =
-    //     crate::sys::scm_hashq_create_handle_x;
+    const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM =
+        crate::sys::scm_hashq_create_handle_x;
 }
 
 /// Hash map vtable that uses the `eqv?` family.
@@ -65,10 +80,12 @@ impl ScmPartialEq for Eqv {
         crate::sys::scm_hashv_set_x;
     const REMOVE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM =
         crate::sys::scm_hashv_remove_x;
+    const REF: unsafe extern "C" fn(_table: SCM, _key: SCM, _dflt: SCM) -> SCM =
+        crate::sys::scm_hashv_ref;
     const GET_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM =
         crate::sys::scm_hashv_get_handle;
-    // const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM =
-    //     crate::sys::scm_hashv_create_handle_x;
+    const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM =
+        crate::sys::scm_hashv_create_handle_x;
 }
 
 /// Hash map vtable that uses the `equal?` family.
@@ -78,10 +95,130 @@ impl ScmPartialEq for Equal {
         crate::sys::scm_hash_set_x;
     const REMOVE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM =
         crate::sys::scm_hash_remove_x;
+    const REF: unsafe extern "C" fn(_table: SCM, _key: SCM, _dflt: SCM) -> SCM =
+        crate::sys::scm_hash_ref;
     const GET_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM =
         crate::sys::scm_hash_get_handle;
-    // const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM =
-    //     crate::sys::scm_hash_create_handle_x;
+    const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM =
+        crate::sys::scm_hash_create_handle_x;
+}
+
+/// Hash map vtable for [HashedString] keys that reuses their cached hash.
+///
+/// Lookups compare the hashes before falling back to `string=?`.
+pub struct Hashed;
+impl Hashed {
+    fn hash_proc() -> SCM {
+        static PROC: LazyLock<AtomicPtr<scm_unused_struct>> = LazyLock::new(|| {
+            unsafe {
+                scm_gc_protect_object(scm_c_make_gsubr(
+                    c"hashed-string-hash".as_ptr(),
+                    2,
+                    0,
+                    0,
+                    hashed_string_hash as *mut c_void,
+                ))
+            }
+            .into()
+        });
+
+        PROC.load(atomic::Ordering::Acquire)
+    }
+    fn assoc_proc() -> SCM {
+        static PROC: LazyLock<AtomicPtr<scm_unused_struct>> = LazyLock::new(|| {
+            unsafe {
+                scm_gc_protect_object(scm_c_make_gsubr(
+                    c"hashed-string-assoc".as_ptr(),
+                    2,
+                    0,
+                    0,
+                    hashed_string_assoc as *mut c_void,
+                ))
+            }
+            .into()
+        });
+
+        PROC.load(atomic::Ordering::Acquire)
+    }
+
+    unsafe extern "C" fn set_x(table: SCM, key: SCM, val: SCM) -> SCM {
+        unsafe { scm_hashx_set_x(Self::hash_proc(), Self::assoc_proc(), table, key, val) }
+    }
+    unsafe extern "C" fn remove_x(table: SCM, key: SCM) -> SCM {
+        unsafe { scm_hashx_remove_x(Self::hash_proc(), Self::assoc_proc(), table, key) }
+    }
+    unsafe extern "C" fn ref_(table: SCM, key: SCM, dflt: SCM) -> SCM {
+        unsafe { scm_hashx_ref(Self::hash_proc(), Self::assoc_proc(), table, key, dflt) }
+    }
+    unsafe extern "C" fn get_handle(table: SCM, key: SCM) -> SCM {
+        unsafe { scm_hashx_get_handle(Self::hash_proc(), Self::assoc_proc(), table, key) }
+    }
+    unsafe extern "C" fn create_handle_x(table: SCM, key: SCM, init: SCM) -> SCM {
+        unsafe {
+            scm_hashx_create_handle_x(Self::hash_proc(), Self::assoc_proc(), table, key, init)
+        }
+    }
+}
+impl ScmPartialEq for Hashed {
+    const SET: unsafe extern "C" fn(_table: SCM, _key: SCM, _val: SCM) -> SCM = Self::set_x;
+    const REMOVE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM = Self::remove_x;
+    const REF: unsafe extern "C" fn(_table: SCM, _key: SCM, _dflt: SCM) -> SCM = Self::ref_;
+    const GET_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM) -> SCM = Self::get_handle;
+    const CREATE_HANDLE: unsafe extern "C" fn(_table: SCM, _key: SCM, _init: SCM) -> SCM =
+        Self::create_handle_x;
+}
+
+/// `(hash key size)` for [HashedString], which just reads the cached hash.
+extern "C" fn hashed_string_hash(key: SCM, size: SCM) -> SCM {
+    unsafe { scm_from_uintptr_t(scm_to_uintptr_t(scm_car(key)) % scm_to_uintptr_t(size)) }
+}
+/// `(assoc key alist)` for [HashedString].
+extern "C" fn hashed_string_assoc(key: SCM, mut alist: SCM) -> SCM {
+    let hash = unsafe { scm_car(key) };
+    while c_predicate(unsafe { scm_is_pair(alist) }) {
+        let entry = unsafe { scm_car(alist) };
+        let other = unsafe { scm_car(entry) };
+        // hashes are always fixnums so they can be compared by identity
+        if other == key
+            || (unsafe { scm_car(other) } == hash
+                && scm_predicate(unsafe { scm_string_equal_p(scm_cdr(key), scm_cdr(other)) }))
+        {
+            return entry;
+        }
+        alist = unsafe { scm_cdr(alist) };
+    }
+
+    unsafe { SCM_BOOL_F }
+}
+
+trait Weakness {
+    /// Create a table with an initial capacity, or the default one if it is `SCM_UNDEFINED`.
+    const MAKE: unsafe extern "C" fn(_n: SCM) -> SCM;
+    /// Check if an object is a table of this kind.
+    const PREDICATE: unsafe extern "C" fn(_obj: SCM) -> SCM;
+}
+
+/// Weak hash map vtable that only holds its keys weakly.
+pub struct WeakKey;
+impl Weakness for WeakKey {
+    const MAKE: unsafe extern "C" fn(_n: SCM) -> SCM = crate::sys::scm_make_weak_key_hash_table;
+    const PREDICATE: unsafe extern "C" fn(_obj: SCM) -> SCM = crate::sys::scm_weak_key_hash_table_p;
+}
+
+/// Weak hash map vtable that only holds its values weakly.
+pub struct WeakValue;
+impl Weakness for WeakValue {
+    const MAKE: unsafe extern "C" fn(_n: SCM) -> SCM = crate::sys::scm_make_weak_value_hash_table;
+    const PREDICATE: unsafe extern "C" fn(_obj: SCM) -> SCM =
+        crate::sys::scm_weak_value_hash_table_p;
+}
+
+/// Weak hash map vtable that holds both keys and values weakly.
+pub struct DoublyWeak;
+impl Weakness for DoublyWeak {
+    const MAKE: unsafe extern "C" fn(_n: SCM) -> SCM = crate::sys::scm_make_doubly_weak_hash_table;
+    const PREDICATE: unsafe extern "C" fn(_obj: SCM) -> SCM =
+        crate::sys::scm_doubly_weak_hash_table_p;
 }
 
 /// Hash map usable in scheme.
@@ -114,6 +251,136 @@ where
             _marker: PhantomData,
         }
     }
+    /// Create a hash map from an iterator, sized with its lower bound.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::HashMap, reference::Ref, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let hm = HashMap::from_iter((0..10).map(|i| (i, i * 2)), guile);
+    ///     assert_eq!(hm.get(4).map(Ref::copied), Some(8));
+    /// }).unwrap();
+    /// ```
+    pub fn from_iter<I>(iter: I, guile: &'gm Guile) -> Self
+    where
+        I: IntoIterator<Item = (K, V)>,
+        K: ToScm<'gm>,
+        V: ToScm<'gm>,
+    {
+        let iter = iter.into_iter();
+        let mut hm = Self::with_capacity(iter.size_hint().0, guile);
+        hm.extend(iter);
+        hm
+    }
+
+    /// Get the number of entries.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::HashMap, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut hm = HashMap::new(guile);
+    ///     assert_eq!(hm.len(), 0);
+    ///     hm.insert(0, 0);
+    ///     hm.insert(0, 1);
+    ///     hm.insert(1, 1);
+    ///     assert_eq!(hm.len(), 2);
+    /// }).unwrap();
+    /// ```
+    pub fn len(&self) -> usize {
+        unsafe { SCM_HASHTABLE_N_ITEMS(self.scm.as_ptr()) }
+            .try_into()
+            .unwrap()
+    }
+    /// Check if there are no entries.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Iterate over all entries in an unspecified order.
+    ///
+    /// This reads the buckets of the table directly without calling back into guile.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::HashMap, reference::Ref, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let hm = HashMap::from_iter((0..100).map(|i| (i, i * 2)), guile);
+    ///     assert_eq!(hm.iter().len(), 100);
+    ///     hm.iter()
+    ///         .map(|(k, v)| (k.copied(), v.copied()))
+    ///         .for_each(|(k, v)| assert_eq!(k * 2, v));
+    /// }).unwrap();
+    /// ```
+    pub fn iter<'a>(&'a self) -> Iter<'a, 'gm, K, V> {
+        Iter {
+            handles: unsafe { Handles::new(self.scm.as_ptr()) },
+            _marker: PhantomData,
+        }
+    }
+    /// Iterate over all keys in an unspecified order.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::HashMap, reference::Ref, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let hm = HashMap::from_iter((0..10).map(|i| (i, ())), guile);
+    ///     let mut keys = hm.keys().map(Ref::copied).collect::<Vec<i32>>();
+    ///     keys.sort();
+    ///     assert_eq!(keys, (0..10).collect::<Vec<_>>());
+    /// }).unwrap();
+    /// ```
+    pub fn keys<'a>(&'a self) -> Keys<'a, 'gm, K, V> {
+        Keys(self.iter())
+    }
+    /// Iterate over all values in an unspecified order.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::HashMap, reference::Ref, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let hm = HashMap::from_iter((0..10).map(|i| ((), i)), guile);
+    ///     assert_eq!(hm.values().map(Ref::copied).collect::<Vec<i32>>(), [9]);
+    /// }).unwrap();
+    /// ```
+    pub fn values<'a>(&'a self) -> Values<'a, 'gm, K, V> {
+        Values(self.iter())
+    }
+    /// Remove and iterate over all entries.
+    ///
+    /// The table is cleared when the iterator is dropped, even if it was not exhausted.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::HashMap, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut hm = HashMap::from_iter((0..10).map(|i| (i, i)), guile);
+    ///     assert_eq!(hm.drain().map(|(k, v)| k + v).sum::<i32>(), 90);
+    ///     assert!(hm.is_empty());
+    /// }).unwrap();
+    /// ```
+    pub fn drain<'a>(&'a mut self) -> Drain<'a, 'gm, K, V, E>
+    where
+        K: TryFromScm<'gm>,
+        V: TryFromScm<'gm>,
+    {
+        Drain {
+            handles: unsafe { Handles::new(self.scm.as_ptr()) },
+            map: self,
+        }
+    }
 
     /// Get the key from the hash table.
     ///
@@ -196,6 +463,54 @@ where
             );
         }
     }
+    /// Get the entry of a key for in place manipulation.
+    ///
+    /// Occupied entries only hash the key once. Vacant entries hash it again on [VacantEntry::insert], so the key is not in the table until its value exists.
+    /// Like [Self::get], values that are not `V` are treated as missing, so inserting into their [VacantEntry] replaces them.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::{Entry, HashMap}, reference::{Ref, ReprScm}, scm::Scm, string::String, subr::Proc, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut counts = HashMap::new(guile);
+    ///     "hello".chars().for_each(|ch| {
+    ///         counts.entry(ch).and_modify(|n| *n += 1).or_insert(1);
+    ///     });
+    ///     assert_eq!(counts.get('l').map(Ref::copied), Some(2));
+    ///     assert_eq!(counts.get('h').map(Ref::copied), Some(1));
+    ///
+    ///     let mut set = unsafe { guile.eval::<Proc>(&String::from_str("(lambda (table) (hash-set! table #\\z \"z\"))", guile)) }.unwrap();
+    ///     assert!(unsafe { set.call::<1, _, Scm>((Scm::from_ptr(counts.as_ptr(), guile),)) }.is_ok());
+    ///     assert!(matches!(counts.entry('z'), Entry::Vacant(_)));
+    ///     assert_eq!(counts.entry('z').or_insert(0).copied(), 0);
+    ///
+    ///     let mut count = unsafe { guile.eval::<Proc>(&String::from_str("(lambda (table) (hash-count (const #t) table))", guile)) }.unwrap();
+    ///     let table = Scm::from_ptr(counts.as_ptr(), guile);
+    ///     assert_eq!(counts.entry('y').or_insert_with(|| unsafe { count.call::<1, _, i32>((table,)) }.unwrap()).copied(), 5);
+    /// }).unwrap();
+    /// ```
+    pub fn entry<'a>(&'a mut self, key: K) -> Entry<'a, 'gm, K, V, E>
+    where
+        K: TryFromScm<'gm> + ToScm<'gm> + 'gm,
+        V: TryFromScm<'gm> + 'gm,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        let key = key.to_scm(guile).as_ptr();
+        let handle = unsafe { E::GET_HANDLE(self.scm.as_ptr(), key) };
+        let handle = c_predicate(unsafe { scm_is_pair(handle) }).then_some(handle);
+        match handle {
+            Some(handle) if Pair::<K, V>::predicate(&Scm::from_ptr(handle, guile), guile) => {
+                Entry::Occupied(OccupiedEntry { map: self, handle })
+            }
+            handle => Entry::Vacant(VacantEntry {
+                map: self,
+                key,
+                handle,
+            }),
+        }
+    }
     /// Remove a key value pair from the hash map.
     ///
     /// ```
@@ -252,23 +567,686 @@ where
     }
 
     fn predicate(hm: &Scm<'gm>, guile: &'gm Guile) -> bool {
-        Scm::from_ptr(unsafe { scm_hash_table_p(hm.as_ptr()) }, guile).is_true() && {
-            let callback = unsafe {
-                scm_c_make_gsubr(
-                    c"hash-map-fold-callback".as_ptr(),
-                    3,
-                    0,
-                    0,
-                    hash_map_fold_callback::<'gm, K, V> as *mut c_void,
-                )
-            };
-            Scm::from_ptr(
-                unsafe { scm_hash_fold(callback, SCM_BOOL_F, hm.as_ptr()) },
-                guile,
+        c_predicate(unsafe { SCM_HASHTABLE_P(hm.as_ptr()) })
+            && unsafe { Handles::new(hm.as_ptr()) }.all(|handle| {
+                let [key, val] = unsafe { [scm_car(handle), scm_cdr(handle)] }
+                    .map(|ptr| Scm::from_ptr(ptr, guile));
+                K::predicate(&key, guile) && V::predicate(&val, guile)
+            })
+    }
+
+    unsafe fn from_scm_unchecked(scm: Scm<'gm>, _: &'gm Guile) -> Self {
+        Self {
+            scm,
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<'gm, K, V, E> Extend<(K, V)> for HashMapInner<'gm, K, V, E>
+where
+    K: ToScm<'gm>,
+    V: ToScm<'gm>,
+    E: ScmPartialEq,
+{
+    fn extend<I>(&mut self, iter: I)
+    where
+        I: IntoIterator<Item = (K, V)>,
+    {
+        iter.into_iter()
+            .for_each(|(key, val)| self.insert(key, val));
+    }
+}
+
+/// Entry created by [HashMapInner::entry].
+pub enum Entry<'a, 'gm, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    /// The key already had a value.
+    Occupied(OccupiedEntry<'a, 'gm, K, V, E>),
+    /// The key did not have a value.
+    Vacant(VacantEntry<'a, 'gm, K, V, E>),
+}
+impl<'a, 'gm, K, V, E> Entry<'a, 'gm, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    /// Insert `default` if the entry is vacant and get a reference to the value.
+    pub fn or_insert(self, default: V) -> RefMut<'a, 'gm, V>
+    where
+        V: ToScm<'gm>,
+    {
+        self.or_insert_with(|| default)
+    }
+    /// Insert the output of `default` if the entry is vacant and get a reference to the value.
+    pub fn or_insert_with<F>(self, default: F) -> RefMut<'a, 'gm, V>
+    where
+        F: FnOnce() -> V,
+        V: ToScm<'gm>,
+    {
+        match self {
+            Self::Occupied(entry) => entry.into_mut(),
+            Self::Vacant(entry) => entry.insert(default()),
+        }
+    }
+    /// Insert the default value if the entry is vacant and get a reference to the value.
+    pub fn or_default(self) -> RefMut<'a, 'gm, V>
+    where
+        V: Default + ToScm<'gm>,
+    {
+        self.or_insert_with(V::default)
+    }
+    /// Modify the value with `f` if the entry is occupied.
+    ///
+    /// The value is converted out of the table, so the modified value is stored back afterwards.
+    pub fn and_modify<F>(self, f: F) -> Self
+    where
+        F: FnOnce(&mut V),
+        V: ToScm<'gm> + TryFromScm<'gm>,
+    {
+        match self {
+            Self::Occupied(mut entry) => {
+                let guile = unsafe { Guile::new_unchecked_ref() };
+                // SAFETY: occupied entries are only created for values that pass the predicate
+                let mut val = unsafe {
+                    V::from_scm_unchecked(Scm::from_ptr(scm_cdr(entry.handle), guile), guile)
+                };
+                f(&mut val);
+                entry.insert(val);
+                Self::Occupied(entry)
+            }
+            vacant => vacant,
+        }
+    }
+}
+
+/// Entry of a key that has a value.
+///
+/// The key and value were checked when the entry was created.
+pub struct OccupiedEntry<'a, 'gm, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    map: &'a mut HashMapInner<'gm, K, V, E>,
+    handle: SCM,
+}
+impl<'a, 'gm, K, V, E> OccupiedEntry<'a, 'gm, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    /// Get a reference to the value.
+    pub fn get(&self) -> Ref<'_, 'gm, V> {
+        // SAFETY: the value was checked by [HashMapInner::entry]
+        unsafe { Ref::new_unchecked(scm_cdr(self.handle)) }
+    }
+    /// Get a mutable reference to the value.
+    pub fn get_mut(&mut self) -> RefMut<'_, 'gm, V> {
+        unsafe { RefMut::new_unchecked(scm_cdr(self.handle)) }
+    }
+    /// Convert the entry into a mutable reference that lives as long as the map.
+    pub fn into_mut(self) -> RefMut<'a, 'gm, V> {
+        unsafe { RefMut::new_unchecked(scm_cdr(self.handle)) }
+    }
+    /// Replace the value without hashing the key again.
+    pub fn insert(&mut self, val: V)
+    where
+        V: ToScm<'gm>,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        unsafe {
+            scm_set_cdr_x(self.handle, val.to_scm(guile).as_ptr());
+        }
+    }
+    /// Remove the entry from the map.
+    pub fn remove(self) -> Pair<'gm, K, V>
+    where
+        K: TryFromScm<'gm>,
+        V: TryFromScm<'gm>,
+    {
+        unsafe {
+            E::REMOVE(self.map.scm.as_ptr(), scm_car(self.handle));
+        }
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        unsafe { Pair::from_scm_unchecked(Scm::from_ptr(self.handle, guile), guile) }
+    }
+}
+
+/// Entry of a key that has no value.
+///
+/// The key is only added to the table by [VacantEntry::insert].
+pub struct VacantEntry<'a, 'gm, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    map: &'a mut HashMapInner<'gm, K, V, E>,
+    key: SCM,
+    /// Handle of the key if it holds a value of another type.
+    handle: Option<SCM>,
+}
+impl<'a, 'gm, K, V, E> VacantEntry<'a, 'gm, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    /// Set the value of the entry.
+    pub fn insert(self, val: V) -> RefMut<'a, 'gm, V>
+    where
+        V: ToScm<'gm>,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        let val = val.to_scm(guile).as_ptr();
+        let handle = match self.handle {
+            Some(handle) => {
+                unsafe {
+                    scm_set_cdr_x(handle, val);
+                }
+                handle
+            }
+            None => unsafe { E::CREATE_HANDLE(self.map.scm.as_ptr(), self.key, val) },
+        };
+        unsafe { RefMut::new_unchecked(scm_cdr(handle)) }
+    }
+}
+
+impl<'gm, K, V, E> IntoIterator for HashMapInner<'gm, K, V, E>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+    E: ScmPartialEq,
+{
+    type Item = (K, V);
+    type IntoIter = IntoIter<'gm, K, V>;
+
+    /// Iterate over all entries in an unspecified order.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::HashMap, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut entries = HashMap::from_iter((0..10).map(|i| (i, i * 2)), guile)
+    ///         .into_iter()
+    ///         .collect::<Vec<(i32, i32)>>();
+    ///     entries.sort();
+    ///     assert_eq!(entries, (0..10).map(|i| (i, i * 2)).collect::<Vec<_>>());
+    /// }).unwrap();
+    /// ```
+    fn into_iter(self) -> Self::IntoIter {
+        IntoIter {
+            handles: unsafe { Handles::new(self.scm.as_ptr()) },
+            _map: self.scm,
+            _marker: PhantomData,
+        }
+    }
+}
+impl<'a, 'gm, K, V, E> IntoIterator for &'a HashMapInner<'gm, K, V, E>
+where
+    K: 'gm,
+    V: 'gm,
+    E: ScmPartialEq,
+{
+    type Item = (Ref<'a, 'gm, K>, Ref<'a, 'gm, V>);
+    type IntoIter = Iter<'a, 'gm, K, V>;
+
+    fn into_iter(self) -> Self::IntoIter {
+        self.iter()
+    }
+}
+
+/// Iterator over the `(key . value)` handles in the bucket vector of a hash table.
+struct Handles {
+    handle: scm_t_array_handle,
+    buckets: *const SCM,
+    step: isize,
+    buckets_left: usize,
+    bucket: SCM,
+    len: usize,
+}
+impl Handles {
+    /// # Safety
+    ///
+    /// `table` must satisfy [SCM_HASHTABLE_P] and must not be modified while this is alive.
+    unsafe fn new(table: SCM) -> Self {
+        let mut handle = Default::default();
+        let mut buckets_left = 0;
+        let mut step = 0;
+        let buckets = unsafe {
+            scm_vector_elements(
+                SCM_HASHTABLE_VECTOR(table),
+                &raw mut handle,
+                &raw mut buckets_left,
+                &raw mut step,
+            )
+        };
+
+        Self {
+            handle,
+            buckets,
+            step,
+            buckets_left,
+            bucket: unsafe { SCM_BOOL_F },
+            len: unsafe { SCM_HASHTABLE_N_ITEMS(table) }.try_into().unwrap(),
+        }
+    }
+}
+impl Drop for Handles {
+    fn drop(&mut self) {
+        unsafe {
+            scm_array_handle_release(&raw mut self.handle);
+        }
+    }
+}
+impl Iterator for Handles {
+    type Item = SCM;
+
+    fn next(&mut self) -> Option<SCM> {
+        loop {
+            if c_predicate(unsafe { scm_is_pair(self.bucket) }) {
+                let handle = unsafe { scm_car(self.bucket) };
+                self.bucket = unsafe { scm_cdr(self.bucket) };
+                self.len = self.len.saturating_sub(1);
+                return Some(handle);
+            } else if self.buckets_left == 0 || self.buckets.is_null() {
+                return None;
+            }
+
+            self.bucket = unsafe { self.buckets.read() };
+            self.buckets = unsafe { self.buckets.offset(self.step) };
+            self.buckets_left -= 1;
+        }
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (self.len, Some(self.len))
+    }
+}
+
+/// Iterator for [HashMapInner::iter].
+pub struct Iter<'a, 'gm, K, V> {
+    handles: Handles,
+    _marker: PhantomData<&'a &'gm (K, V)>,
+}
+impl<K, V> ExactSizeIterator for Iter<'_, '_, K, V> {}
+impl<K, V> FusedIterator for Iter<'_, '_, K, V> {}
+impl<'a, 'gm, K, V> Iterator for Iter<'a, 'gm, K, V> {
+    type Item = (Ref<'a, 'gm, K>, Ref<'a, 'gm, V>);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        self.handles.next().map(|handle| unsafe {
+            (
+                Ref::new_unchecked(scm_car(handle)),
+                Ref::new_unchecked(scm_cdr(handle)),
+            )
+        })
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.handles.size_hint()
+    }
+}
+
+/// Iterator for [HashMapInner::into_iter].
+pub struct IntoIter<'gm, K, V> {
+    handles: Handles,
+    /// Keeps the table alive while its buckets are read.
+    _map: Scm<'gm>,
+    _marker: PhantomData<(K, V)>,
+}
+impl<'gm, K, V> ExactSizeIterator for IntoIter<'gm, K, V>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+{
+}
+impl<'gm, K, V> FusedIterator for IntoIter<'gm, K, V>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+{
+}
+impl<'gm, K, V> Iterator for IntoIter<'gm, K, V>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+{
+    type Item = (K, V);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        self.handles.next().map(|handle| unsafe {
+            (
+                K::from_scm_unchecked(Scm::from_ptr(scm_car(handle), guile), guile),
+                V::from_scm_unchecked(Scm::from_ptr(scm_cdr(handle), guile), guile),
+            )
+        })
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.handles.size_hint()
+    }
+}
+
+/// Iterator for [HashMapInner::keys].
+pub struct Keys<'a, 'gm, K, V>(Iter<'a, 'gm, K, V>);
+impl<K, V> ExactSizeIterator for Keys<'_, '_, K, V> {}
+impl<K, V> FusedIterator for Keys<'_, '_, K, V> {}
+impl<'a, 'gm, K, V> Iterator for Keys<'a, 'gm, K, V> {
+    type Item = Ref<'a, 'gm, K>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        self.0.next().map(|(key, _)| key)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.0.size_hint()
+    }
+}
+
+/// Iterator for [HashMapInner::values].
+pub struct Values<'a, 'gm, K, V>(Iter<'a, 'gm, K, V>);
+impl<K, V> ExactSizeIterator for Values<'_, '_, K, V> {}
+impl<K, V> FusedIterator for Values<'_, '_, K, V> {}
+impl<'a, 'gm, K, V> Iterator for Values<'a, 'gm, K, V> {
+    type Item = Ref<'a, 'gm, V>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        self.0.next().map(|(_, val)| val)
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.0.size_hint()
+    }
+}
+
+/// Iterator for [HashMapInner::drain].
+pub struct Drain<'a, 'gm, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    handles: Handles,
+    map: &'a mut HashMapInner<'gm, K, V, E>,
+}
+impl<K, V, E> Drop for Drain<'_, '_, K, V, E>
+where
+    E: ScmPartialEq,
+{
+    fn drop(&mut self) {
+        unsafe {
+            scm_hash_clear_x(self.map.scm.as_ptr());
+        }
+    }
+}
+impl<'gm, K, V, E> ExactSizeIterator for Drain<'_, 'gm, K, V, E>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+    E: ScmPartialEq,
+{
+}
+impl<'gm, K, V, E> FusedIterator for Drain<'_, 'gm, K, V, E>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+    E: ScmPartialEq,
+{
+}
+impl<'gm, K, V, E> Iterator for Drain<'_, 'gm, K, V, E>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+    E: ScmPartialEq,
+{
+    type Item = (K, V);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        self.handles.next().map(|handle| unsafe {
+            (
+                K::from_scm_unchecked(Scm::from_ptr(scm_car(handle), guile), guile),
+                V::from_scm_unchecked(Scm::from_ptr(scm_cdr(handle), guile), guile),
             )
-            .is_true()
+        })
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.handles.size_hint()
+    }
+}
+
+/// Hash map that does not keep its keys, values or both alive.
+///
+/// Entries disappear once the weakly held parts are garbage collected.
+/// Guile does not give out handles to weak tables, so there is no entry api or borrowing iterator.
+///
+/// [Hashed] cannot be used here since guile's `hashx` functions do not support weak tables.
+#[repr(transparent)]
+pub struct WeakHashMapInner<'gm, K, V, E, W>
+where
+    E: ScmPartialEq,
+    W: Weakness,
+{
+    scm: Scm<'gm>,
+    _marker: PhantomData<(K, V, E, W)>,
+}
+impl<'gm, K, V, E, W> WeakHashMapInner<'gm, K, V, E, W>
+where
+    E: ScmPartialEq,
+    W: Weakness,
+{
+    /// Create an empty hash map.
+    pub fn new(guile: &'gm Guile) -> Self {
+        Self {
+            scm: Scm::from_ptr(unsafe { W::MAKE(SCM_UNDEFINED) }, guile),
+            _marker: PhantomData,
         }
     }
+    /// Create a hash map with a specified capacity.
+    pub fn with_capacity(cap: usize, guile: &'gm Guile) -> Self {
+        Self {
+            scm: Scm::from_ptr(unsafe { W::MAKE(cap.to_scm(guile).as_ptr()) }, guile),
+            _marker: PhantomData,
+        }
+    }
+
+    /// Get the value of a key.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::WeakKeyHashMapQ, reference::Ref, symbol::Symbol, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let key = Symbol::from_str("key", guile);
+    ///     let mut cache = WeakKeyHashMapQ::new(guile);
+    ///     assert!(cache.get(key).is_none());
+    ///     cache.insert(key, 6);
+    ///     assert_eq!(cache.get(key).map(Ref::copied), Some(6));
+    /// }).unwrap();
+    /// ```
+    pub fn get<'a>(&'a self, key: K) -> Option<Ref<'a, 'gm, V>>
+    where
+        K: ToScm<'gm>,
+        V: TryFromScm<'gm> + 'gm,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        let val = unsafe { E::REF(self.scm.as_ptr(), key.to_scm(guile).as_ptr(), SCM_UNDEFINED) };
+        (!c_predicate(unsafe { SCM_UNBNDP(val) })
+            && V::predicate(&Scm::from_ptr(val, guile), guile))
+        .then(|| unsafe { Ref::new_unchecked(val) })
+    }
+    /// Check if there is a value for a key.
+    pub fn contains_key(&self, key: K) -> bool
+    where
+        K: ToScm<'gm>,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        !c_predicate(unsafe {
+            SCM_UNBNDP(E::REF(
+                self.scm.as_ptr(),
+                key.to_scm(guile).as_ptr(),
+                SCM_UNDEFINED,
+            ))
+        })
+    }
+
+    /// Insert a key value pair into the hash map.
+    pub fn insert(&mut self, key: K, val: V)
+    where
+        K: ToScm<'gm>,
+        V: ToScm<'gm>,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        unsafe {
+            E::SET(
+                self.scm.as_ptr(),
+                key.to_scm(guile).as_ptr(),
+                val.to_scm(guile).as_ptr(),
+            );
+        }
+    }
+    /// Remove a key from the hash map and return its value.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::WeakValueHashMap, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut hm = WeakValueHashMap::new(guile);
+    ///     hm.insert(1, 2);
+    ///     assert_eq!(hm.remove(1), Some(2));
+    ///     assert_eq!(hm.remove(1), None);
+    /// }).unwrap();
+    /// ```
+    pub fn remove(&mut self, key: K) -> Option<V>
+    where
+        K: ToScm<'gm>,
+        V: TryFromScm<'gm>,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        let key = key.to_scm(guile).as_ptr();
+        let val = unsafe { E::REF(self.scm.as_ptr(), key, SCM_UNDEFINED) };
+        if c_predicate(unsafe { SCM_UNBNDP(val) }) {
+            None
+        } else {
+            unsafe {
+                E::REMOVE(self.scm.as_ptr(), key);
+            }
+            V::try_from_scm(Scm::from_ptr(val, guile), guile).ok()
+        }
+    }
+
+    /// Run a closure on every live entry in an unspecified order.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::hash_map::DoublyWeakHashMap, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut hm = DoublyWeakHashMap::new(guile);
+    ///     hm.insert(1, 2);
+    ///     hm.insert(3, 4);
+    ///     let mut sum = 0;
+    ///     hm.for_each(|k, v| sum += k.copied() + v.copied());
+    ///     assert_eq!(sum, 10);
+    /// }).unwrap();
+    /// ```
+    pub fn for_each<F>(&self, mut f: F)
+    where
+        K: 'gm,
+        V: 'gm,
+        F: for<'a> FnMut(Ref<'a, 'gm, K>, Ref<'a, 'gm, V>),
+    {
+        unsafe extern "C" fn callback<'gm, K, V, F>(
+            closure: *mut c_void,
+            key: SCM,
+            val: SCM,
+            result: SCM,
+        ) -> SCM
+        where
+            K: 'gm,
+            V: 'gm,
+            F: for<'a> FnMut(Ref<'a, 'gm, K>, Ref<'a, 'gm, V>),
+        {
+            let f = unsafe { closure.cast::<F>().as_mut() }.unwrap();
+            f(unsafe { Ref::new_unchecked(key) }, unsafe {
+                Ref::new_unchecked(val)
+            });
+            result
+        }
+
+        unsafe {
+            scm_internal_hash_fold(
+                Some(callback::<'gm, K, V, F>),
+                (&raw mut f).cast(),
+                SCM_BOOL_F,
+                self.scm.as_ptr(),
+            );
+        }
+    }
+}
+unsafe impl<K, V, E, W> ReprScm for WeakHashMapInner<'_, K, V, E, W>
+where
+    E: ScmPartialEq,
+    W: Weakness,
+{
+}
+impl<'gm, K, V, E, W> ToScm<'gm> for WeakHashMapInner<'gm, K, V, E, W>
+where
+    E: ScmPartialEq,
+    W: Weakness,
+{
+    fn to_scm(self, _: &'gm Guile) -> Scm<'gm> {
+        self.scm
+    }
+}
+impl<'gm, K, V, E, W> TryFromScm<'gm> for WeakHashMapInner<'gm, K, V, E, W>
+where
+    K: TryFromScm<'gm>,
+    V: TryFromScm<'gm>,
+    E: ScmPartialEq,
+    W: Weakness,
+{
+    fn type_name() -> Cow<'static, CStr> {
+        CString::new(format!(
+            "(weak-hash-map {} {})",
+            K::type_name().display(),
+            V::type_name().display()
+        ))
+        .map(Cow::Owned)
+        .unwrap_or(Cow::Borrowed(c"weak-hash-map"))
+    }
+
+    fn predicate(hm: &Scm<'gm>, guile: &'gm Guile) -> bool {
+        unsafe extern "C" fn callback<'gm, K, V>(
+            _: *mut c_void,
+            key: SCM,
+            val: SCM,
+            result: SCM,
+        ) -> SCM
+        where
+            K: TryFromScm<'gm>,
+            V: TryFromScm<'gm>,
+        {
+            let guile = unsafe { Guile::new_unchecked_ref() };
+            let [key, val] = [key, val].map(|ptr| Scm::from_ptr(ptr, guile));
+            (scm_predicate(result) && K::predicate(&key, guile) && V::predicate(&val, guile))
+                .to_scm(guile)
+                .as_ptr()
+        }
+
+        scm_predicate(unsafe { W::PREDICATE(hm.as_ptr()) })
+            && scm_predicate(unsafe {
+                scm_internal_hash_fold(
+                    Some(callback::<'gm, K, V>),
+                    std::ptr::null_mut(),
+                    true.to_scm(guile).as_ptr(),
+                    hm.as_ptr(),
+                )
+            })
+    }
 
     unsafe fn from_scm_unchecked(scm: Scm<'gm>, _: &'gm Guile) -> Self {
         Self {
@@ -284,19 +1262,38 @@ pub type HashMap<'gm, K, V> = HashMapInner<'gm, K, V, Equal>;
 pub type HashMapQ<'gm, K, V> = HashMapInner<'gm, K, V, Eq>;
 /// Hash map that uses `eqv?` for comparison
 pub type HashMapV<'gm, K, V> = HashMapInner<'gm, K, V, Eqv>;
-
-extern "C" fn hash_map_fold_callback<'gm, K, V>(key: SCM, val: SCM, accum: SCM) -> SCM
-where
-    K: TryFromScm<'gm>,
-    V: TryFromScm<'gm>,
-{
-    let guile = unsafe { Guile::new_unchecked_ref() };
-    if Scm::from_ptr(accum, guile).is_false() {
-        false
-    } else {
-        let [key, val] = [key, val].map(|ptr| Scm::from_ptr(ptr, guile));
-        K::predicate(&key, guile) && V::predicate(&val, guile)
-    }
-    .to_scm(guile)
-    .as_ptr()
-}
+/// Hash map keyed by strings that are only hashed once.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{collections::hash_map::StringHashMap, reference::Ref, string::HashedString, with_guile};
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let key = HashedString::from_str("foo", guile);
+///     let mut hm = StringHashMap::new(guile);
+///     hm.insert(key, 1);
+///     assert_eq!(hm.get(key).map(Ref::copied), Some(1));
+///     assert_eq!(hm.get(HashedString::from_str("foo", guile)).map(Ref::copied), Some(1));
+///     assert!(hm.get(HashedString::from_str("bar", guile)).is_none());
+/// }).unwrap();
+/// ```
+pub type StringHashMap<'gm, V> = HashMapInner<'gm, HashedString<'gm>, V, Hashed>;
+/// Hash map with weak keys that uses `equal?` for comparison
+pub type WeakKeyHashMap<'gm, K, V> = WeakHashMapInner<'gm, K, V, Equal, WeakKey>;
+/// Hash map with weak keys that uses `eq?` for comparison
+pub type WeakKeyHashMapQ<'gm, K, V> = WeakHashMapInner<'gm, K, V, Eq, WeakKey>;
+/// Hash map with weak keys that uses `eqv?` for comparison
+pub type WeakKeyHashMapV<'gm, K, V> = WeakHashMapInner<'gm, K, V, Eqv, WeakKey>;
+/// Hash map with weak values that uses `equal?` for comparison
+pub type WeakValueHashMap<'gm, K, V> = WeakHashMapInner<'gm, K, V, Equal, WeakValue>;
+/// Hash map with weak values that uses `eq?` for comparison
+pub type WeakValueHashMapQ<'gm, K, V> = WeakHashMapInner<'gm, K, V, Eq, WeakValue>;
+/// Hash map with weak values that uses `eqv?` for comparison
+pub type WeakValueHashMapV<'gm, K, V> = WeakHashMapInner<'gm, K, V, Eqv, WeakValue>;
+/// Hash map with weak keys and values that uses `equal?` for comparison
+pub type DoublyWeakHashMap<'gm, K, V> = WeakHashMapInner<'gm, K, V, Equal, DoublyWeak>;
+/// Hash map with weak keys and values that uses `eq?` for comparison
+pub type DoublyWeakHashMapQ<'gm, K, V> = WeakHashMapInner<'gm, K, V, Eq, DoublyWeak>;
+/// Hash map with weak keys and values that uses `eqv?` for comparison
+pub type DoublyWeakHashMapV<'gm, K, V> = WeakHashMapInner<'gm, K, V, Eqv, DoublyWeak>;
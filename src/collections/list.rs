@@ -29,7 +29,7 @@ use {
         subr::Proc,
         sys::{
             SCM, SCM_EOL, scm_car, scm_cdr, scm_char_set_to_list, scm_cons, scm_hook_to_list,
-            scm_list_p, scm_vector_to_list,
+            scm_list_p, scm_set_cdr_x, scm_vector_to_list,
         },
         utils::{CowCStrExt, scm_predicate},
     },
@@ -98,6 +98,42 @@ impl<'gm, T> List<'gm, T> {
         iter.into_iter()
             .fold(Self::new(guile), |accum, item| accum.push_front(item))
     }
+    /// Create a list in the order of the iterator without collecting it first.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::list::List, reference::Ref, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let list = List::from_iter_in_order(1..4, guile);
+    ///     assert_eq!(list.iter().map(Ref::copied).collect::<Vec<i32>>(), [1, 2, 3]);
+    ///     assert!(List::<i32>::from_iter_in_order([], guile).is_empty());
+    /// }).unwrap();
+    /// ```
+    pub fn from_iter_in_order<I>(iter: I, guile: &'gm Guile) -> Self
+    where
+        I: IntoIterator<Item = T>,
+        T: ToScm<'gm>,
+    {
+        let mut iter = iter.into_iter();
+        let Some(head) = iter.next() else {
+            return Self::new(guile);
+        };
+        let head = unsafe { scm_cons(head.to_scm(guile).as_ptr(), SCM_EOL) };
+        iter.fold(head, |tail, item| {
+            let pair = unsafe { scm_cons(item.to_scm(guile).as_ptr(), SCM_EOL) };
+            unsafe {
+                scm_set_cdr_x(tail, pair);
+            }
+            pair
+        });
+
+        Self {
+            scm: Scm::from_ptr(head, guile),
+            _marker: PhantomData,
+        }
+    }
     /// Add an element to the front of the list.
     ///
     /// # Examples
@@ -0,0 +1,620 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Concurrent hash map implemented in rust.
+//!
+//! [SharedMap] never calls into guile, and [SharedTable] exposes one to scheme as a foreign object.
+
+use {
+    crate::{
+        Guile,
+        foreign_object::ForeignObject,
+        module::Module,
+        reference::ReprScm,
+        scm::{Scm, ToScm, TryFromScm},
+        string::String,
+        subr::{GuileFn, guile_fn},
+        symbol::Symbol,
+        sys::{SCM, scm_gc_protect_object, scm_gc_unprotect_object},
+    },
+    parking_lot::RwLock,
+    std::{
+        borrow::Borrow,
+        hash::{BuildHasher, Hash, RandomState},
+        mem,
+        num::NonZeroUsize,
+        sync::LazyLock,
+        thread,
+    },
+};
+
+const GROUP_WIDTH: usize = mem::size_of::<u64>();
+const EMPTY: u8 = 0b1111_1111;
+const DELETED: u8 = 0b1000_0000;
+
+/// Control bytes of a group of buckets, compared all at once.
+#[derive(Clone, Copy)]
+struct Group(u64);
+impl Group {
+    const LSB: u64 = u64::from_ne_bytes([0x01; GROUP_WIDTH]);
+    const MSB: u64 = u64::from_ne_bytes([0x80; GROUP_WIDTH]);
+
+    fn load(ctrl: &[u8], group: usize) -> Self {
+        let start = group * GROUP_WIDTH;
+        Self(u64::from_le_bytes(
+            ctrl[start..start + GROUP_WIDTH].try_into().unwrap(),
+        ))
+    }
+
+    /// Buckets that might contain `h2`.
+    ///
+    /// This can have false positives, which are filtered out by comparing keys.
+    fn match_byte(self, h2: u8) -> BitMask {
+        let cmp = self.0 ^ (Self::LSB * u64::from(h2));
+        BitMask(cmp.wrapping_sub(Self::LSB) & !cmp & Self::MSB)
+    }
+    fn match_empty(self) -> BitMask {
+        BitMask(self.0 & (self.0 << 1) & Self::MSB)
+    }
+    fn match_empty_or_deleted(self) -> BitMask {
+        BitMask(self.0 & Self::MSB)
+    }
+}
+
+/// Iterator over the indexes of set high bits in a [Group].
+struct BitMask(u64);
+impl BitMask {
+    fn any(&self) -> bool {
+        self.0 != 0
+    }
+}
+impl Iterator for BitMask {
+    type Item = usize;
+
+    fn next(&mut self) -> Option<usize> {
+        (self.0 != 0).then(|| {
+            let i = self.0.trailing_zeros() as usize / 8;
+            self.0 &= self.0 - 1;
+            i
+        })
+    }
+}
+
+/// Single threaded open addressing table with SwissTable style control bytes.
+struct RawTable<K, V> {
+    ctrl: Box<[u8]>,
+    slots: Box<[Option<(K, V)>]>,
+    items: usize,
+    growth_left: usize,
+}
+impl<K, V> RawTable<K, V> {
+    fn new() -> Self {
+        Self {
+            ctrl: Box::new([]),
+            slots: Box::new([]),
+            items: 0,
+            growth_left: 0,
+        }
+    }
+    fn with_capacity(cap: usize) -> Self {
+        if cap == 0 {
+            return Self::new();
+        }
+
+        let buckets = (cap * 8 / 7 + 1).next_power_of_two().max(GROUP_WIDTH);
+        Self {
+            ctrl: vec![EMPTY; buckets].into_boxed_slice(),
+            slots: (0..buckets).map(|_| None).collect(),
+            items: 0,
+            growth_left: buckets / 8 * 7,
+        }
+    }
+
+    fn h1(hash: u64) -> usize {
+        hash as usize
+    }
+    fn h2(hash: u64) -> u8 {
+        (hash >> (u64::BITS - 7)) as u8
+    }
+
+    /// Triangular probe sequence over groups, which visits every group once.
+    fn probe(&self, hash: u64) -> impl Iterator<Item = usize> {
+        let mask = self.ctrl.len() / GROUP_WIDTH - 1;
+        let start = Self::h1(hash) & mask;
+        (0..=mask).scan(start, move |pos, stride| {
+            let group = *pos;
+            *pos = (*pos + stride + 1) & mask;
+            Some(group)
+        })
+    }
+
+    fn find<Q>(&self, hash: u64, key: &Q) -> Option<usize>
+    where
+        K: Borrow<Q>,
+        Q: Eq + ?Sized,
+    {
+        if self.ctrl.is_empty() {
+            return None;
+        }
+
+        let h2 = Self::h2(hash);
+        for group in self.probe(hash) {
+            let ctrl = Group::load(&self.ctrl, group);
+            if let Some(i) = ctrl
+                .match_byte(h2)
+                .map(|i| group * GROUP_WIDTH + i)
+                .find(|i| {
+                    self.slots[*i]
+                        .as_ref()
+                        .is_some_and(|(k, _)| k.borrow() == key)
+                })
+            {
+                return Some(i);
+            } else if ctrl.match_empty().any() {
+                return None;
+            }
+        }
+
+        None
+    }
+
+    fn get<Q>(&self, hash: u64, key: &Q) -> Option<&V>
+    where
+        K: Borrow<Q>,
+        Q: Eq + ?Sized,
+    {
+        self.find(hash, key)
+            .and_then(|i| self.slots[i].as_ref())
+            .map(|(_, v)| v)
+    }
+
+    fn insert(&mut self, hash: u64, key: K, val: V, hasher: &dyn Fn(&K) -> u64) -> Option<V>
+    where
+        K: Eq,
+    {
+        if let Some(i) = self.find(hash, &key) {
+            return self.slots[i].as_mut().map(|(_, v)| mem::replace(v, val));
+        }
+
+        if self.growth_left == 0 {
+            self.resize((self.items + 1) * 2, hasher);
+        }
+        self.insert_unique(hash, key, val);
+
+        None
+    }
+    /// Insert a key that is known to not be in the table, which must have room for it.
+    fn insert_unique(&mut self, hash: u64, key: K, val: V) {
+        let i = self
+            .probe(hash)
+            .find_map(|group| {
+                Group::load(&self.ctrl, group)
+                    .match_empty_or_deleted()
+                    .next()
+                    .map(|i| group * GROUP_WIDTH + i)
+            })
+            .expect("tables always have empty buckets");
+        if self.ctrl[i] == EMPTY {
+            self.growth_left -= 1;
+        }
+        self.ctrl[i] = Self::h2(hash);
+        self.slots[i] = Some((key, val));
+        self.items += 1;
+    }
+
+    fn remove<Q>(&mut self, hash: u64, key: &Q) -> Option<(K, V)>
+    where
+        K: Borrow<Q>,
+        Q: Eq + ?Sized,
+    {
+        self.find(hash, key).and_then(|i| {
+            // tombstones keep probe sequences that pass through this bucket intact
+            self.ctrl[i] = DELETED;
+            self.items -= 1;
+            self.slots[i].take()
+        })
+    }
+
+    /// Move every item into a new table, which also clears out tombstones.
+    fn resize(&mut self, cap: usize, hasher: &dyn Fn(&K) -> u64) {
+        let old = mem::replace(self, Self::with_capacity(cap));
+        old.slots
+            .into_iter()
+            .flatten()
+            .for_each(|(k, v)| self.insert_unique(hasher(&k), k, v));
+    }
+
+    fn drain(&mut self) -> impl Iterator<Item = (K, V)> {
+        mem::replace(self, Self::new()).slots.into_iter().flatten()
+    }
+}
+
+/// Hash map that can be shared between threads.
+///
+/// Keys are spread over shards that each have their own lock, so readers and writers of different shards never contend.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::collections::shared_map::SharedMap;
+/// # use std::thread;
+/// let map = SharedMap::new();
+/// thread::scope(|s| {
+///     (0..4).for_each(|t| {
+///         let map = &map;
+///         s.spawn(move || (0..100).for_each(|i| {
+///             map.insert(t * 100 + i, i);
+///         }));
+///     });
+/// });
+/// assert_eq!(map.len(), 400);
+/// assert_eq!(map.get(&250), Some(50));
+/// ```
+pub struct SharedMap<K, V, S = RandomState> {
+    shards: Box<[RwLock<RawTable<K, V>>]>,
+    hasher: S,
+}
+impl<K, V> SharedMap<K, V> {
+    /// Create an empty map.
+    pub fn new() -> Self {
+        Self::with_hasher(RandomState::new())
+    }
+    /// Create a map with space for at least `cap` items.
+    pub fn with_capacity(cap: usize) -> Self {
+        Self::with_capacity_and_hasher(cap, RandomState::new())
+    }
+}
+impl<K, V> Default for SharedMap<K, V> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+impl<K, V, S> SharedMap<K, V, S> {
+    fn shard_count() -> usize {
+        thread::available_parallelism()
+            .map(NonZeroUsize::get)
+            .unwrap_or(1)
+            .saturating_mul(4)
+            .next_power_of_two()
+    }
+
+    /// Create an empty map that uses `hasher`.
+    pub fn with_hasher(hasher: S) -> Self {
+        Self::with_capacity_and_hasher(0, hasher)
+    }
+    /// Create a map with space for at least `cap` items that uses `hasher`.
+    pub fn with_capacity_and_hasher(cap: usize, hasher: S) -> Self {
+        let shards = Self::shard_count();
+        Self {
+            shards: (0..shards)
+                .map(|_| RwLock::new(RawTable::with_capacity(cap.div_ceil(shards))))
+                .collect(),
+            hasher,
+        }
+    }
+
+    /// Get the number of items.
+    ///
+    /// This locks every shard in turn, so the result may already be stale when other threads are writing.
+    pub fn len(&self) -> usize {
+        self.shards.iter().map(|shard| shard.read().items).sum()
+    }
+    /// Check if there are no items.
+    pub fn is_empty(&self) -> bool {
+        self.shards.iter().all(|shard| shard.read().items == 0)
+    }
+    /// Remove every item.
+    pub fn clear(&self) {
+        self.shards.iter().for_each(|shard| {
+            let _ = shard.write().drain();
+        });
+    }
+    /// Remove every item and return them.
+    pub fn drain(&self) -> Vec<(K, V)> {
+        self.shards
+            .iter()
+            .flat_map(|shard| shard.write().drain().collect::<Vec<_>>())
+            .collect()
+    }
+}
+impl<K, V, S> SharedMap<K, V, S>
+where
+    K: Hash + Eq,
+    S: BuildHasher,
+{
+    fn shard<Q>(&self, key: &Q) -> (u64, &RwLock<RawTable<K, V>>)
+    where
+        Q: Hash + ?Sized,
+    {
+        let hash = self.hasher.hash_one(key);
+        // the low bits pick the first group and the top 7 are stored in the control bytes
+        let shard = (hash >> 32) as usize & (self.shards.len() - 1);
+        (hash, &self.shards[shard])
+    }
+
+    /// Run a closure on the value of a key while its shard is locked for reading.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::collections::shared_map::SharedMap;
+    /// let map = SharedMap::new();
+    /// map.insert("routes", vec!["/", "/about"]);
+    /// assert_eq!(map.get_with("routes", Vec::len), Some(2));
+    /// assert_eq!(map.get_with("missing", Vec::len), None);
+    /// ```
+    pub fn get_with<Q, F, R>(&self, key: &Q, f: F) -> Option<R>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+        F: FnOnce(&V) -> R,
+    {
+        let (hash, shard) = self.shard(key);
+        shard.read().get(hash, key).map(f)
+    }
+    /// Get a copy of the value of a key.
+    pub fn get<Q>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+        V: Clone,
+    {
+        self.get_with(key, V::clone)
+    }
+    /// Check if there is a value for a key.
+    pub fn contains_key<Q>(&self, key: &Q) -> bool
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        self.get_with(key, |_| ()).is_some()
+    }
+
+    /// Insert a value and return the previous value of the key.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::collections::shared_map::SharedMap;
+    /// let map = SharedMap::new();
+    /// assert_eq!(map.insert(1, 'a'), None);
+    /// assert_eq!(map.insert(1, 'b'), Some('a'));
+    /// ```
+    pub fn insert(&self, key: K, val: V) -> Option<V> {
+        let (hash, shard) = self.shard(&key);
+        shard
+            .write()
+            .insert(hash, key, val, &|key| self.hasher.hash_one(key))
+    }
+    /// Remove a key and return its value.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::collections::shared_map::SharedMap;
+    /// let map = SharedMap::new();
+    /// map.insert(1, 'a');
+    /// assert_eq!(map.remove(&1), Some('a'));
+    /// assert_eq!(map.remove(&1), None);
+    /// ```
+    pub fn remove<Q>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let (hash, shard) = self.shard(key);
+        shard.write().remove(hash, key).map(|(_, v)| v)
+    }
+}
+
+/// Scheme object kept alive for as long as it is inside of a [SharedTable].
+struct Protected(SCM);
+// SAFETY: guile objects are shared by every guile thread.
+unsafe impl Send for Protected {}
+unsafe impl Sync for Protected {}
+impl Protected {
+    fn new(scm: Scm<'_>) -> Self {
+        Self(unsafe { scm_gc_protect_object(scm.as_ptr()) })
+    }
+    fn get<'gm>(&self, guile: &'gm Guile) -> Scm<'gm> {
+        Scm::from_ptr(self.0, guile)
+    }
+    fn release<'gm>(self, guile: &'gm Guile) -> Scm<'gm> {
+        unsafe {
+            scm_gc_unprotect_object(self.0);
+        }
+        Scm::from_ptr(self.0, guile)
+    }
+}
+
+/// Storage of a [SharedTable], which can only be created in a `static`.
+///
+/// Every guile thread could hold a reference to the table, so it is never freed: the storage and the values still in it live for the whole program.
+/// Removing or replacing a value releases it.
+pub struct SharedTableStorage(LazyLock<SharedMap<Box<str>, Protected>>);
+impl SharedTableStorage {
+    /// Create empty storage, which is only allocated when the table is first used.
+    #[expect(clippy::new_without_default)]
+    pub const fn new() -> Self {
+        Self(LazyLock::new(SharedMap::new))
+    }
+}
+
+/// [SharedMap] from strings to scheme objects that is usable in scheme.
+///
+/// Tables are backed by a [SharedTableStorage] in a `static`, so they are never freed.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{collections::shared_map::{SharedTable, SharedTableStorage}, module::Module, scm::TryFromScm, string::String, symbol::Symbol, with_guile};
+/// static TABLE: SharedTableStorage = SharedTableStorage::new();
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let table = SharedTable::new(&TABLE);
+///     let mut module = Module::current(guile);
+///     table.define_procedures(&mut module);
+///     module.define(Symbol::from_str("table", guile), table);
+///
+///     table.insert("answer", 42, guile);
+///     assert_eq!(unsafe { guile.eval::<i32>(&String::from_str("(shared-map-ref table \"answer\")", guile)) }, Ok(42));
+///     assert_eq!(unsafe { guile.eval::<usize>(&String::from_str("(begin (shared-map-set! table \"x\" 1) (shared-map-count table))", guile)) }, Ok(2));
+///     assert_eq!(table.get("x", guile).map(|x| i32::try_from_scm(x, guile)), Some(Ok(1)));
+/// }).unwrap();
+/// ```
+#[derive(Clone, Copy, ForeignObject, ToScm, TryFromScm)]
+pub struct SharedTable(&'static SharedMap<Box<str>, Protected>);
+impl SharedTable {
+    /// Get the table backed by `storage`.
+    pub fn new(storage: &'static SharedTableStorage) -> Self {
+        Self(&storage.0)
+    }
+
+    /// Get the value of a key.
+    pub fn get<'gm>(&self, key: &str, guile: &'gm Guile) -> Option<Scm<'gm>> {
+        self.0.get_with(key, |val| val.get(guile))
+    }
+    /// Insert a value and return the previous value of the key.
+    pub fn insert<'gm, T>(&self, key: &str, val: T, guile: &'gm Guile) -> Option<Scm<'gm>>
+    where
+        T: ToScm<'gm>,
+    {
+        self.0
+            .insert(key.into(), Protected::new(val.to_scm(guile)))
+            .map(|old| old.release(guile))
+    }
+    /// Remove a key and return its value.
+    pub fn remove<'gm>(&self, key: &str, guile: &'gm Guile) -> Option<Scm<'gm>> {
+        self.0.remove(key).map(|old| old.release(guile))
+    }
+    /// Get the number of items.
+    pub fn len(&self) -> usize {
+        self.0.len()
+    }
+    /// Check if there are no items.
+    pub fn is_empty(&self) -> bool {
+        self.0.is_empty()
+    }
+
+    /// Define `shared-map-ref`, `shared-map-set!`, `shared-map-remove!` and `shared-map-count` in a module.
+    pub fn define_procedures(&self, module: &mut Module<'_>) {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        module.define(
+            Symbol::from_str("shared-map-ref", guile),
+            SharedMapRef::create(guile),
+        );
+        module.define(
+            Symbol::from_str("shared-map-set!", guile),
+            SharedMapSet::create(guile),
+        );
+        module.define(
+            Symbol::from_str("shared-map-remove!", guile),
+            SharedMapRemove::create(guile),
+        );
+        module.define(
+            Symbol::from_str("shared-map-count", guile),
+            SharedMapCount::create(guile),
+        );
+    }
+}
+
+#[guile_fn(garguile_root = crate)]
+fn shared_map_ref<'gm>(
+    #[guile] guile: &'gm Guile,
+    table: &SharedTable,
+    key: &String<'gm>,
+    #[optional] default: Option<&Scm<'gm>>,
+) -> Scm<'gm> {
+    table
+        .get(&key.as_string(), guile)
+        .or_else(|| default.map(|default| unsafe { default.copy_unchecked() }))
+        .unwrap_or_else(|| false.to_scm(guile))
+}
+#[guile_fn(garguile_root = crate, guile_ident = c"shared-map-set!")]
+fn shared_map_set<'gm>(
+    #[guile] guile: &'gm Guile,
+    table: &SharedTable,
+    key: &String<'gm>,
+    val: &Scm<'gm>,
+) {
+    table.insert(&key.as_string(), unsafe { val.copy_unchecked() }, guile);
+}
+#[guile_fn(garguile_root = crate, guile_ident = c"shared-map-remove!")]
+fn shared_map_remove<'gm>(
+    #[guile] guile: &'gm Guile,
+    table: &SharedTable,
+    key: &String<'gm>,
+) -> Scm<'gm> {
+    table
+        .remove(&key.as_string(), guile)
+        .unwrap_or_else(|| false.to_scm(guile))
+}
+#[guile_fn(garguile_root = crate)]
+fn shared_map_count(table: &SharedTable) -> usize {
+    table.len()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn group_matching() {
+        let ctrl = [0x12, EMPTY, DELETED, 0x34, 0x12, EMPTY, 0x00, 0x7f];
+        let group = Group::load(&ctrl, 0);
+        assert_eq!(group.match_byte(0x12).collect::<Vec<_>>(), [0, 4]);
+        assert_eq!(group.match_empty().collect::<Vec<_>>(), [1, 5]);
+        assert_eq!(
+            group.match_empty_or_deleted().collect::<Vec<_>>(),
+            [1, 2, 5]
+        );
+    }
+
+    #[test]
+    fn raw_table_tombstones() {
+        let map = SharedMap::<usize, usize>::with_capacity(16);
+        (0..1000).for_each(|i| {
+            assert_eq!(map.insert(i, i), None);
+            if i % 2 == 0 {
+                assert_eq!(map.remove(&i), Some(i));
+            }
+        });
+        assert_eq!(map.len(), 500);
+        (0..1000).for_each(|i| assert_eq!(map.get(&i), (i % 2 == 1).then_some(i)));
+        assert_eq!(map.drain().len(), 500);
+        assert!(map.is_empty());
+    }
+
+    #[test]
+    fn shared_map_threads() {
+        let map = SharedMap::<std::string::String, usize>::new();
+        thread::scope(|s| {
+            (0..4).for_each(|t| {
+                let map = &map;
+                s.spawn(move || {
+                    (0..50).for_each(|i| {
+                        map.insert(format!("{t}-{i}"), i);
+                        assert_eq!(map.get(format!("{t}-{i}").as_str()), Some(i));
+                    })
+                });
+            });
+        });
+        assert_eq!(map.len(), 200);
+        assert_eq!(map.insert("3-7".into(), 0), Some(7));
+        assert!(map.contains_key("0-49"));
+        map.clear();
+        assert!(!map.contains_key("0-49"));
+    }
+}
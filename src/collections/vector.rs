@@ -19,13 +19,14 @@ use {
     crate::{
         Guile,
         collections::list::List,
-        reference::{Ref, RefMut, ReprScm},
+        reference::{KeepAlive, Ref, RefMut, ReprScm},
         scm::{Scm, ToScm, TryFromScm},
         sys::{
-            SCM, scm_array_handle_release, scm_c_make_vector, scm_t_array_handle, scm_vector,
-            scm_vector_elements, scm_vector_p, scm_vector_writable_elements,
+            SCM, SCM_BOOL_F, scm_array_handle_release, scm_c_make_vector, scm_c_vector_length,
+            scm_c_vector_ref, scm_c_vector_set_x, scm_is_vector, scm_t_array_handle, scm_vector,
+            scm_vector_elements, scm_vector_writable_elements,
         },
-        utils::{CowCStrExt, scm_predicate},
+        utils::{CowCStrExt, c_predicate},
     },
     std::{
         borrow::Cow,
@@ -78,6 +79,53 @@ impl<'gm, T> Vector<'gm, T> {
         }
     }
 
+    /// Create a vector from an iterator of known length, writing each item as it is produced.
+    ///
+    /// If the iterator yields fewer items than [ExactSizeIterator::len] reported, the vector is truncated to them, and any extra items are never consumed.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::vector::Vector, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     assert_eq!(
+    ///         Vector::from_exact_iter((0..4).map(|i| i * 2), guile).into_iter().collect::<Vec<i32>>(),
+    ///         [0, 2, 4, 6],
+    ///     );
+    /// }).unwrap();
+    /// ```
+    pub fn from_exact_iter<I>(iter: I, guile: &'gm Guile) -> Self
+    where
+        I: IntoIterator<Item = T>,
+        I::IntoIter: ExactSizeIterator,
+        T: ToScm<'gm>,
+    {
+        let iter = iter.into_iter();
+        let len = iter.len();
+        let mut vector = unsafe { scm_c_make_vector(len, SCM_BOOL_F) };
+        let written = iter
+            .take(len)
+            .map(|item| item.to_scm(guile).as_ptr())
+            .fold(0, |i, item| {
+                unsafe { scm_c_vector_set_x(vector, i, item) };
+                i + 1
+            });
+        // `len` is only a hint, so don't leave `#f` where a `T` should be
+        if written < len {
+            let truncated = unsafe { scm_c_make_vector(written, SCM_BOOL_F) };
+            (0..written).for_each(|i| unsafe {
+                scm_c_vector_set_x(truncated, i, scm_c_vector_ref(vector, i));
+            });
+            vector = truncated;
+        }
+
+        Self {
+            scm: Scm::from_ptr(vector, guile),
+            _marker: PhantomData,
+        }
+    }
+
     /// Get an immutable iterator.
     ///
     /// # Examples
@@ -113,6 +161,7 @@ impl<'gm, T> Vector<'gm, T> {
             ptr,
             len: NonZeroUsize::new(len),
             step,
+            _keep_alive: KeepAlive::new(&self.scm),
             _marker: PhantomData,
         }
     }
@@ -155,6 +204,7 @@ impl<'gm, T> Vector<'gm, T> {
             ptr,
             len: NonZeroUsize::new(len),
             step,
+            _keep_alive: KeepAlive::new(&self.scm),
             _marker: PhantomData,
         }
     }
@@ -184,6 +234,7 @@ where
             ptr,
             len: NonZeroUsize::new(len),
             step,
+            _keep_alive: KeepAlive::new(&self.scm),
             _marker: PhantomData,
         }
     }
@@ -226,8 +277,14 @@ where
             .unwrap_or(Cow::Borrowed(c"vector"))
     }
 
-    fn predicate(scm: &Scm<'gm>, _: &'gm Guile) -> bool {
-        scm_predicate(unsafe { scm_vector_p(scm.as_ptr()) }) && { todo!("type check all values") }
+    fn predicate(scm: &Scm<'gm>, guile: &'gm Guile) -> bool {
+        c_predicate(unsafe { scm_is_vector(scm.as_ptr()) })
+            && (0..unsafe { scm_c_vector_length(scm.as_ptr()) }).all(|i| {
+                T::predicate(
+                    &Scm::from_ptr(unsafe { scm_c_vector_ref(scm.as_ptr(), i) }, guile),
+                    guile,
+                )
+            })
     }
 
     unsafe fn from_scm_unchecked(scm: Scm<'gm>, _: &'gm Guile) -> Self {
@@ -247,6 +304,7 @@ where
     ptr: *const SCM,
     step: isize,
     len: Option<NonZeroUsize>,
+    _keep_alive: KeepAlive<'gm>,
     _marker: PhantomData<&'gm T>,
 }
 impl<'gm, T> DoubleEndedIterator for IntoIter<'gm, T>
@@ -312,6 +370,7 @@ where
     ptr: *const SCM,
     step: isize,
     len: Option<NonZeroUsize>,
+    _keep_alive: KeepAlive<'gm>,
     _marker: PhantomData<&'a &'gm T>,
 }
 impl<'gm, T> DoubleEndedIterator for Iter<'_, 'gm, T>
@@ -375,6 +434,7 @@ where
     ptr: *mut SCM,
     step: isize,
     len: Option<NonZeroUsize>,
+    _keep_alive: KeepAlive<'gm>,
     _marker: PhantomData<&'a &'gm T>,
 }
 impl<'gm, T> DoubleEndedIterator for IterMut<'_, 'gm, T>
@@ -451,6 +511,25 @@ mod tests {
         .unwrap();
     }
 
+    #[cfg_attr(miri, ignore)]
+    #[test]
+    fn vector_predicate() {
+        with_guile(|guile| {
+            let vec = Vector::new(1, 3, guile).to_scm(guile);
+            assert!(Vector::<i32>::predicate(&vec, guile));
+            assert!(!Vector::<bool>::predicate(&vec, guile));
+            assert!(Vector::<i32>::predicate(
+                &Vector::<i32>::from_exact_iter([], guile).to_scm(guile),
+                guile
+            ));
+            assert!(!Vector::<i32>::predicate(
+                &List::from_iter([1], guile).to_scm(guile),
+                guile
+            ));
+        })
+        .unwrap();
+    }
+
     /// Test that we can have multiple handles
     #[cfg_attr(miri, ignore)]
     #[test]
@@ -477,4 +556,31 @@ mod tests {
         })
         .unwrap();
     }
+
+    #[cfg_attr(miri, ignore)]
+    #[test]
+    fn vector_from_lying_exact_iter() {
+        /// Iterator that claims to have more items than it yields.
+        struct Lying(std::ops::Range<i32>);
+        impl Iterator for Lying {
+            type Item = i32;
+
+            fn next(&mut self) -> Option<i32> {
+                self.0.next()
+            }
+        }
+        impl ExactSizeIterator for Lying {
+            fn len(&self) -> usize {
+                self.0.len() + 2
+            }
+        }
+
+        with_guile(|guile| {
+            let vec = Vector::from_exact_iter(Lying(0..3), guile).to_scm(guile);
+            assert!(Vector::<i32>::predicate(&vec, guile));
+            let vec = unsafe { Vector::<i32>::from_scm_unchecked(vec, guile) };
+            assert_eq!(vec.into_iter().collect::<Vec<_>>(), [0, 1, 2]);
+        })
+        .unwrap();
+    }
 }
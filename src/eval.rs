@@ -13,15 +13,60 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-use crate::{
-    Guile,
-    module::Module,
-    reference::ReprScm,
-    scm::{Scm, TryFromScm},
-    string::String,
-    sys::{scm_eval_string, scm_eval_string_in_module, scm_primitive_load},
+use {
+    crate::{
+        Guile,
+        module::Module,
+        reference::ReprScm,
+        scm::{Scm, TryFromScm},
+        string::String,
+        subr::Proc,
+        symbol::Symbol,
+        sys::{
+            SCM, scm_c_public_ref, scm_current_module, scm_eof_object_p, scm_eval_string,
+            scm_eval_string_in_module, scm_from_locale_stringn, scm_gc_protect_object,
+            scm_gc_unprotect_object, scm_primitive_load, scm_symbol_to_keyword,
+        },
+        utils::scm_predicate,
+    },
+    parking_lot::RwLock,
+    std::{collections::HashMap, ffi::CStr, fs, path::Path, sync::LazyLock},
 };
 
+/// Procedures made by [Guile::compile_proc], keyed by the module they were compiled in and then by their source.
+///
+/// Modules with cached procedures are protected from garbage collection so their addresses are not reused.
+static COMPILED_PROCS: LazyLock<RwLock<HashMap<usize, HashMap<Box<str>, usize>>>> =
+    LazyLock::new(Default::default);
+
+/// Bindings used by [Guile::compile_proc] that are looked up once.
+struct Compiler {
+    open_input_string: usize,
+    read: usize,
+    compile: usize,
+    env: usize,
+    optimization_level: usize,
+}
+static COMPILER: LazyLock<Compiler> = LazyLock::new(|| {
+    let guile = unsafe { Guile::new_unchecked_ref() };
+    let public = |module: &CStr, name: &CStr| unsafe {
+        scm_gc_protect_object(scm_c_public_ref(module.as_ptr(), name.as_ptr())) as usize
+    };
+    let keyword = |name| unsafe {
+        scm_gc_protect_object(scm_symbol_to_keyword(
+            Symbol::from_str(name, guile).as_ptr(),
+        )) as usize
+    };
+
+    Compiler {
+        open_input_string: public(c"guile", c"open-input-string"),
+        read: public(c"guile", c"read"),
+        compile: public(c"system base compile", c"compile"),
+        env: keyword("env"),
+        optimization_level: keyword("optimization-level"),
+    }
+});
+
 impl Guile {
     /// # Safety
     ///
@@ -47,6 +92,62 @@ impl Guile {
         }
     }
 
+    /// Load a file from a compiled copy at `cache`, compiling it first if the copy is missing or older than the file.
+    ///
+    /// This skips expanding and compiling the file on later startups.
+    /// Only the modification time of `source` itself is compared, so files it pulls in with `include` or `load` don't make the copy stale.
+    ///
+    /// Paths are passed to guile as bytes in the locale encoding, like the file names guile gets from the command line.
+    ///
+    /// # Safety
+    ///
+    /// See [Self::load_path].
+    ///
+    /// # Examples
+    /// ```
+    /// # use garguile::{module::Module, symbol::Symbol, with_guile};
+    /// # use std::fs;
+    /// # use tempfile::TempDir;
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let dir = TempDir::new().unwrap();
+    ///     let source = dir.path().join("config.scm");
+    ///     let cache = dir.path().join("config.go");
+    ///     fs::write(&source, "(define cached-var 7)").unwrap();
+    ///     unsafe { guile.load_compiled(&source, &cache); }
+    ///     assert!(cache.exists());
+    ///     unsafe { guile.load_compiled(&source, &cache); }
+    ///     assert_eq!(Module::current(guile).read::<i32>(Symbol::from_str("cached-var", guile)).unwrap().unwrap().copied(), 7);
+    /// }).unwrap();
+    /// ```
+    pub unsafe fn load_compiled(&self, source: &Path, cache: &Path) {
+        let modified = |path: &Path| fs::metadata(path).and_then(|metadata| metadata.modified());
+        let fresh = modified(cache)
+            .and_then(|cache| modified(source).map(|source| source <= cache))
+            .unwrap_or(false);
+        let source = path_to_scm(source, self);
+        let cache = path_to_scm(cache, self);
+
+        if !fresh {
+            let output_file = unsafe {
+                Scm::from_ptr(
+                    scm_symbol_to_keyword(Symbol::from_str("output-file", self).as_ptr()),
+                    self,
+                )
+            };
+            unsafe {
+                public_proc(c"system base compile", c"compile-file", self).call::<3, _, Scm>((
+                    source,
+                    output_file,
+                    cache.copy_unchecked(),
+                ))
+            }
+            .expect("any object can be converted to a `Scm`");
+        }
+        unsafe { public_proc(c"guile", c"load-compiled", self).call::<1, _, Scm>((cache,)) }
+            .expect("any object can be converted to a `Scm`");
+    }
+
     /// # Safety
     ///
     /// Since you can do very unsafe things in scheme, there is probably no way to make this safe.
@@ -83,4 +184,176 @@ impl Guile {
             self,
         )
     }
+
+    /// Compile a procedure like `(lambda (x) x)` at optimization level 2, or get it from the cache if the same source was already compiled in the current module.
+    ///
+    /// The procedure is compiled in the current module and is never garbage collected until [Self::invalidate_proc] is called from that module.
+    /// The source must be a single expression. If it isn't, or doesn't evaluate to a procedure, this returns the first trailing expression or the value.
+    ///
+    /// # Safety
+    ///
+    /// See [Self::eval].
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{reference::ReprScm, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut square = unsafe { guile.compile_proc("(lambda (x) (* x x))") }.unwrap();
+    ///     assert_eq!(unsafe { square.call((4,)) }, Ok(16));
+    ///     let cached = unsafe { guile.compile_proc("(lambda (x) (* x x))") }.unwrap();
+    ///     assert_eq!(square.as_ptr(), cached.as_ptr());
+    ///     assert!(guile.invalidate_proc("(lambda (x) (* x x))"));
+    ///     assert!(!guile.invalidate_proc("(lambda (x) (* x x))"));
+    ///     assert!(unsafe { guile.compile_proc("42") }.is_err());
+    ///     assert!(unsafe { guile.compile_proc("(lambda (x) x) (delete-file \"/\")") }.is_err());
+    /// }).unwrap();
+    /// ```
+    ///
+    /// The same source compiled in another module refers to that module's bindings.
+    ///
+    /// ```
+    /// # use garguile::{module::{Module, ModulePool}, scm::ToScm, string::String, subr::Proc, symbol::Symbol, with_guile};
+    /// static POOL: ModulePool = ModulePool::new();
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     Module::current(guile).define(Symbol::from_str("scale", guile), 2);
+    ///     let mut double = unsafe { guile.compile_proc("(lambda (x) (* x scale))") }.unwrap();
+    ///     assert_eq!(unsafe { double.call((4,)) }, Ok(8));
+    ///
+    ///     let mut other = POOL.get(guile);
+    ///     other.define(Symbol::from_str("scale", guile), 3);
+    ///     let compile_scale = Proc::from_closure(|guile, _| {
+    ///         unsafe { guile.compile_proc("(lambda (x) (* x scale))") }.unwrap().to_scm(guile)
+    ///     }, guile);
+    ///     other.define(Symbol::from_str("compile-scale", guile), compile_scale);
+    ///     assert_eq!(unsafe { guile.eval_in::<i32>(&String::from_str("((compile-scale) 4)", guile), &other) }, Ok(12));
+    /// }).unwrap();
+    /// ```
+    ///
+    /// Procedures compiled in a module taken from a [ModulePool][crate::module::ModulePool] are dropped from the cache when it is returned, so the next user of the module compiles its own.
+    ///
+    /// ```
+    /// # use garguile::{module::ModulePool, reference::ReprScm, scm::ToScm, string::String, subr::Proc, symbol::Symbol, with_guile};
+    /// static POOL: ModulePool = ModulePool::new();
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut addresses = Vec::new();
+    ///     for scale in [2, 3] {
+    ///         let mut module = POOL.get(guile);
+    ///         addresses.push(module.as_ptr());
+    ///         module.define(Symbol::from_str("scale", guile), scale);
+    ///         let compile_scale = Proc::from_closure(|guile, _| {
+    ///             unsafe { guile.compile_proc("(lambda () scale)") }.unwrap().to_scm(guile)
+    ///         }, guile);
+    ///         module.define(Symbol::from_str("compile-scale", guile), compile_scale);
+    ///         assert_eq!(unsafe { guile.eval_in::<i32>(&String::from_str("((compile-scale))", guile), &module) }, Ok(scale));
+    ///     }
+    ///     assert_eq!(addresses[0], addresses[1]);
+    /// }).unwrap();
+    /// ```
+    pub unsafe fn compile_proc<'gm>(&'gm self, source: &str) -> Result<Proc<'gm>, Scm<'gm>> {
+        let module = unsafe { scm_current_module() };
+        if let Some(proc) = COMPILED_PROCS
+            .read()
+            .get(&(module as usize))
+            .and_then(|procs| procs.get(source))
+            .copied()
+        {
+            return Ok(unsafe { Proc::from_scm_unchecked(Scm::from_ptr(proc as SCM, self), self) });
+        }
+
+        let scm = |ptr: usize| Scm::from_ptr(ptr as SCM, self);
+        let proc = |ptr: usize| unsafe { Proc::from_scm_unchecked(scm(ptr), self) };
+
+        let port = unsafe {
+            proc(COMPILER.open_input_string).call::<1, _, Scm>((String::from_str(source, self),))
+        }
+        .expect("any object can be converted to a `Scm`");
+        let expr = unsafe { proc(COMPILER.read).call::<1, _, Scm>((port.copy_unchecked(),)) }
+            .expect("any object can be converted to a `Scm`");
+        let trailing = unsafe { proc(COMPILER.read).call::<1, _, Scm>((port,)) }
+            .expect("any object can be converted to a `Scm`");
+        if !scm_predicate(unsafe { scm_eof_object_p(trailing.as_ptr()) }) {
+            return Err(trailing);
+        }
+
+        let compiled = unsafe {
+            proc(COMPILER.compile).call::<5, _, Proc>((
+                expr,
+                scm(COMPILER.env),
+                Scm::from_ptr(module, self),
+                scm(COMPILER.optimization_level),
+                2,
+            ))
+        }?;
+
+        let mut procs = COMPILED_PROCS.write();
+        let procs = procs.entry(module as usize).or_insert_with(|| {
+            unsafe { scm_gc_protect_object(module) };
+            HashMap::new()
+        });
+        let compiled = *procs
+            .entry(source.into())
+            .or_insert_with(|| unsafe { scm_gc_protect_object(compiled.as_ptr()) } as usize);
+        Ok(unsafe { Proc::from_scm_unchecked(Scm::from_ptr(compiled as SCM, self), self) })
+    }
+
+    /// Remove a procedure compiled in the current module from the cache of [Self::compile_proc], returning whether it was cached.
+    ///
+    /// Handles that were already returned stay valid while they are reachable.
+    pub fn invalidate_proc(&self, source: &str) -> bool {
+        let module = unsafe { scm_current_module() } as usize;
+        let mut cache = COMPILED_PROCS.write();
+        let Some(procs) = cache.get_mut(&module) else {
+            return false;
+        };
+        let removed = procs
+            .remove(source)
+            .inspect(|proc| unsafe {
+                scm_gc_unprotect_object(*proc as SCM);
+            })
+            .is_some();
+        if procs.is_empty() {
+            cache.remove(&module);
+            unsafe { scm_gc_unprotect_object(module as SCM) };
+        }
+        removed
+    }
+}
+
+/// Drop every procedure [Guile::compile_proc] cached for `module`, so a module that is reused does not hand them out again.
+///
+/// # Safety
+///
+/// You must be in guile mode.
+pub(crate) unsafe fn forget_compiled_procs(module: SCM) {
+    if let Some(procs) = COMPILED_PROCS.write().remove(&(module as usize)) {
+        procs.into_values().for_each(|proc| unsafe {
+            scm_gc_unprotect_object(proc as SCM);
+        });
+        unsafe { scm_gc_unprotect_object(module) };
+    }
+}
+
+/// Convert a path to a scheme string, decoding its bytes with the locale like guile does for file names.
+fn path_to_scm<'gm>(path: &Path, guile: &'gm Guile) -> Scm<'gm> {
+    let bytes = path.as_os_str().as_encoded_bytes();
+    Scm::from_ptr(
+        unsafe { scm_from_locale_stringn(bytes.as_ptr().cast(), bytes.len()) },
+        guile,
+    )
+}
+
+/// Get a procedure exported by a module.
+pub(crate) fn public_proc<'gm>(module: &CStr, name: &CStr, guile: &'gm Guile) -> Proc<'gm> {
+    Proc::try_from_scm(
+        Scm::from_ptr(
+            unsafe { scm_c_public_ref(module.as_ptr(), name.as_ptr()) },
+            guile,
+        ),
+        guile,
+    )
+    .expect("the module should export this procedure")
 }
@@ -17,6 +17,10 @@
 
 #![expect(private_bounds)]
 
+// lets the derive macros, which default to `::garguile`, be used inside of this crate
+extern crate self as garguile;
+
+pub mod alist;
 pub mod alloc;
 pub mod catch;
 pub mod collections;
@@ -28,15 +32,21 @@ pub mod hook;
 pub mod module;
 pub mod num;
 mod primitive;
+pub mod record;
 #[doc(hidden)]
 pub mod reexports;
 pub mod reference;
+pub mod root;
+pub mod sandbox;
 pub mod scm;
+#[cfg(feature = "serde")]
+pub mod serde;
 pub mod string;
 pub mod subr;
 pub mod symbol;
 pub mod sys;
 mod utils;
+pub mod variant;
 
 use std::ptr::NonNull;
 
@@ -18,23 +18,204 @@
 use {
     crate::{
         Guile,
+        catch::Tag,
         collections::list::List,
+        eval::{forget_compiled_procs, public_proc},
         reference::{Ref, RefMut, ReprScm},
         scm::{Scm, ToScm, TryFromScm},
+        string::String,
+        subr::{NamedGuileFn, Proc},
         symbol::Symbol,
         sys::{
-            SCM_MODULEP, scm_current_module, scm_defined_p, scm_maybe_resolve_module,
-            scm_module_define, scm_module_lookup, scm_module_public_interface, scm_resolve_module,
-            scm_variable_ref,
+            SCM, SCM_MODULEP, scm_c_define_module, scm_current_module, scm_defined_p,
+            scm_gc_protect_object, scm_gc_unprotect_object, scm_maybe_resolve_module,
+            scm_module_define, scm_module_export, scm_module_lookup, scm_module_public_interface,
+            scm_resolve_module, scm_unused_struct, scm_variable_ref,
         },
         utils::{c_predicate, scm_predicate},
     },
-    std::{borrow::Cow, ffi::CStr},
+    parking_lot::Mutex,
+    std::{
+        borrow::Cow,
+        ffi::{CStr, CString},
+        ops::{Deref, DerefMut},
+        ptr,
+        sync::{
+            LazyLock,
+            atomic::{self, AtomicPtr},
+        },
+    },
 };
 
 /// Module paths like `'(ice-9 sandbox)`
 pub type ModulePath<'gm> = List<'gm, Symbol<'gm>>;
 
+/// Create a [ModuleDef] from a module path, procedures made by [guile_fn] and constants.
+///
+/// This is the bulk form of [Module::define_fn], which defines a single procedure in an existing module.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{define_module, module::ModuleDef, string::String, subr::{GuileFn, guile_fn}, with_guile};
+/// #[guile_fn]
+/// fn double(i: &i32) -> i32 {
+///     *i * 2
+/// }
+/// #[guile_fn]
+/// fn triple(i: &i32) -> i32 {
+///     *i * 3
+/// }
+/// static ARITHMETIC: ModuleDef = define_module!(
+///     ["garguile", "arithmetic"],
+///     [Double, Triple],
+///     ["answer" => 42],
+/// );
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     ARITHMETIC.define(guile);
+///     assert_eq!(
+///         unsafe { guile.eval::<i32>(&String::from_str("(use-modules (garguile arithmetic)) (double (triple answer))", guile)) },
+///         Ok(252),
+///     );
+/// }).unwrap();
+/// ```
+///
+/// [guile_fn]: crate::subr::guile_fn
+#[macro_export]
+macro_rules! define_module {
+    ([$($path:literal),+ $(,)?], [$($proc:ty),* $(,)?] $(, [$($name:literal => $value:expr),* $(,)?])? $(,)?) => {
+        $crate::module::ModuleDef {
+            path: &[$($path),+],
+            procs: &[$((
+                <$proc as $crate::subr::NamedGuileFn>::NAME,
+                <$proc as $crate::subr::GuileFn>::create,
+            )),*],
+            constants: &[$($(($name, {
+                fn constant<'gm>(guile: &'gm $crate::Guile) -> $crate::scm::Scm<'gm> {
+                    $crate::scm::ToScm::to_scm($value, guile)
+                }
+                constant
+            })),*)?],
+        }
+    };
+}
+
+/// Table of procedures and constants of a module, created by [define_module][crate::define_module].
+pub struct ModuleDef {
+    #[doc(hidden)]
+    pub path: &'static [&'static str],
+    #[doc(hidden)]
+    pub procs: &'static [(&'static CStr, for<'gm> fn(&'gm Guile) -> Proc<'gm>)],
+    #[doc(hidden)]
+    pub constants: &'static [(&'static str, for<'gm> fn(&'gm Guile) -> Scm<'gm>)],
+}
+impl ModuleDef {
+    /// Create the module like `define-module` if needed, so that it has a public interface.
+    fn module<'gm>(&self, guile: &'gm Guile) -> Module<'gm> {
+        let name = CString::new(self.path.join(" ")).expect("module names should not contain nul");
+        Module::try_from_scm(
+            Scm::from_ptr(
+                unsafe { scm_c_define_module(name.as_ptr(), None, ptr::null_mut()) },
+                guile,
+            ),
+            guile,
+        )
+        .expect("`scm_c_define_module` should always return a module")
+    }
+
+    /// Create the module if needed, then define and export everything in it with a single export.
+    pub fn define<'gm>(&self, guile: &'gm Guile) -> Module<'gm> {
+        let module = self.module(guile);
+
+        let procs = self.procs.iter().map(|(name, create)| {
+            (
+                Symbol::from_str(
+                    name.to_str().expect("procedure names should be valid utf8"),
+                    guile,
+                ),
+                create(guile).to_scm(guile),
+            )
+        });
+        let constants = self
+            .constants
+            .iter()
+            .map(|(name, constant)| (Symbol::from_str(name, guile), constant(guile)));
+        let exports = List::from_iter(
+            procs.chain(constants).map(|(sym, val)| {
+                unsafe {
+                    scm_module_define(module.as_ptr(), sym.as_ptr(), val.as_ptr());
+                }
+                sym
+            }),
+            guile,
+        );
+        unsafe {
+            scm_module_export(module.as_ptr(), exports.as_ptr());
+        }
+
+        module
+    }
+
+    /// Create the module, but only define its contents when one of its bindings is first looked up, such as after `use-modules`.
+    ///
+    /// This is done with the binder of the public interface, so imports that list every binding like `#:prefix` need [ModuleDef::define] instead.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{define_module, module::ModuleDef, string::String, subr::{GuileFn, guile_fn}, with_guile};
+    /// #[guile_fn]
+    /// fn negate(i: &i32) -> i32 {
+    ///     -*i
+    /// }
+    /// static LAZY: ModuleDef = define_module!(["garguile", "lazy"], [Negate]);
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     LAZY.autoload(guile);
+    ///     assert_eq!(
+    ///         unsafe { guile.eval::<i32>(&String::from_str("(use-modules (garguile lazy)) (negate 1)", guile)) },
+    ///         Ok(-1),
+    ///     );
+    /// }).unwrap();
+    /// ```
+    pub fn autoload(&'static self, guile: &Guile) {
+        let interface = self
+            .module(guile)
+            .public_interface()
+            .expect("modules made by `define-module` should have a public interface");
+        let binder = Proc::from_closure(
+            move |guile, args| {
+                let mut args = args.iter();
+                let (Some(interface), Some(sym)) = (args.next(), args.next()) else {
+                    return false.to_scm(guile);
+                };
+                let (interface, sym) =
+                    unsafe { (interface.copy_unchecked(), sym.copy_unchecked()) };
+
+                // the binder is removed first so that defining the module does not load it again
+                unsafe {
+                    public_proc(c"guile", c"set-module-binder!", guile)
+                        .call::<2, _, Scm>((interface.copy_unchecked(), false))
+                }
+                .expect("any object can be converted to a `Scm`");
+                self.define(guile);
+                unsafe {
+                    public_proc(c"guile", c"module-local-variable", guile)
+                        .call::<2, _, Scm>((interface, sym))
+                }
+                .expect("any object can be converted to a `Scm`")
+            },
+            guile,
+        );
+        unsafe {
+            public_proc(c"guile", c"set-module-binder!", guile)
+                .call::<2, _, Scm>((interface.0, binder))
+        }
+        .expect("any object can be converted to a `Scm`");
+    }
+}
+
 /// Environment containing symbols.
 #[repr(transparent)]
 pub struct Module<'gm>(Scm<'gm>);
@@ -138,6 +319,54 @@ impl<'gm> Module<'gm> {
         }
     }
 
+    /// Define and export a procedure made by [guile_fn][crate::subr::guile_fn] under its name.
+    ///
+    /// The module needs a public interface, like the modules made by `define-module`.
+    /// This returns [None] without defining anything if it doesn't have one.
+    ///
+    /// To define many procedures with a single export, use [define_module][crate::define_module] instead.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{list, module::Module, subr::{GuileFn, Proc, guile_fn}, symbol::Symbol, with_guile};
+    /// #[guile_fn]
+    /// fn halve(i: &i32) -> i32 {
+    ///     *i / 2
+    /// }
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut module = Module::current(guile);
+    ///     assert!(module.define_fn::<Halve>(guile).is_some());
+    ///     let public = module.public_interface().unwrap();
+    ///     assert!(public.read::<Proc>(Symbol::from_str("halve", guile)).unwrap().is_ok());
+    ///
+    ///     let mut private = Module::get_or_create(&list!(guile, Symbol::from_str("garguile-private", guile)));
+    ///     assert!(private.public_interface().is_none());
+    ///     assert!(private.define_fn::<Halve>(guile).is_none());
+    ///     assert!(!private.is_defined(Symbol::from_str("halve", guile)));
+    /// }).unwrap();
+    /// ```
+    pub fn define_fn<'a, F>(&mut self, guile: &'gm Guile) -> Option<RefMut<'a, 'gm, Proc<'gm>>>
+    where
+        F: NamedGuileFn,
+    {
+        // `scm_module_export` throws, which would unwind through rust frames
+        self.public_interface()?;
+
+        let sym = Symbol::from_str(
+            F::NAME
+                .to_str()
+                .expect("procedure names should be valid utf8"),
+            guile,
+        );
+        let proc = self.define(sym, F::create(guile));
+        unsafe {
+            scm_module_export(self.0.as_ptr(), List::from_iter([sym], guile).as_ptr());
+        }
+        Some(proc)
+    }
+
     /// Read a symbol from a module.
     ///
     /// # Examples
@@ -216,3 +445,161 @@ impl<'gm> ToScm<'gm> for Module<'gm> {
         self.0
     }
 }
+
+/// Pool of anonymous modules that are cleared when they are returned, so isolated environments do not need a new module each time.
+///
+/// Returning a module clears its bindings, replaces its public interface with a fresh one, clears its imports (including autoloads, which are imports), binder, transformer, duplicates handlers, observers, submodules and the procedures [Guile::compile_proc] cached for it, then imports `(guile)` again like `make-fresh-user-module`.
+/// Code run in it can still change state outside of it, like bindings of other modules, which is not undone.
+/// If the module was left in a state the reset throws on, it is dropped from the pool instead.
+///
+/// Modules in the pool are never garbage collected.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{module::ModulePool, string::String, symbol::Symbol, with_guile};
+/// static POOL: ModulePool = ModulePool::new();
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     {
+///         let mut module = POOL.get(guile);
+///         module.define(Symbol::from_str("tenant", guile), 1);
+///         assert_eq!(unsafe { guile.eval_in::<i32>(&String::from_str("(+ tenant 1)", guile), &module) }, Ok(2));
+///     }
+///     let module = POOL.get(guile);
+///     assert_eq!(unsafe { guile.eval_in::<bool>(&String::from_str("(defined? 'tenant)", guile), &module) }, Ok(false));
+///     assert_eq!(unsafe { guile.eval_in::<i32>(&String::from_str("(+ 1 1)", guile), &module) }, Ok(2));
+/// }).unwrap();
+/// ```
+///
+/// Hooks that resolve bindings on demand are cleared too.
+///
+/// ```
+/// # use garguile::{module::ModulePool, scm::Scm, string::String, with_guile};
+/// static POOL: ModulePool = ModulePool::new();
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     {
+///         let module = POOL.get(guile);
+///         assert!(unsafe {
+///             guile.eval_in::<Scm>(
+///                 &String::from_str("(set-module-binder! (current-module) (lambda (m sym define?) (and (eq? sym 'leaked) (make-variable 1))))", guile),
+///                 &module,
+///             )
+///         }
+///         .is_ok());
+///         assert_eq!(unsafe { guile.eval_in::<i32>(&String::from_str("leaked", guile), &module) }, Ok(1));
+///         // the reset must not throw when the public interface is gone
+///         assert!(unsafe { guile.eval_in::<Scm>(&String::from_str("(set-module-public-interface! (current-module) #f)", guile), &module) }.is_ok());
+///     }
+///     let module = POOL.get(guile);
+///     assert_eq!(unsafe { guile.eval_in::<bool>(&String::from_str("(defined? 'leaked)", guile), &module) }, Ok(false));
+/// }).unwrap();
+/// ```
+pub struct ModulePool {
+    modules: Mutex<Vec<usize>>,
+}
+impl ModulePool {
+    /// Create an empty pool.
+    pub const fn new() -> Self {
+        Self {
+            modules: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// Take a module from the pool or create one like `make-fresh-user-module`.
+    pub fn get<'a, 'gm>(&'a self, guile: &'gm Guile) -> PooledModule<'a, 'gm> {
+        let module = self.modules.lock().pop().map_or_else(
+            || unsafe {
+                let mut make_fresh_user_module =
+                    public_proc(c"guile", c"make-fresh-user-module", guile);
+                let module = make_fresh_user_module
+                    .call::<0, _, Scm>(())
+                    .expect("any object can be converted to a `Scm`");
+                scm_gc_protect_object(module.as_ptr())
+            },
+            |module| module as SCM,
+        );
+
+        PooledModule {
+            pool: self,
+            module: Module(Scm::from_ptr(module, guile)),
+        }
+    }
+}
+impl Default for ModulePool {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Module taken from a [ModulePool], which is cleared and returned when dropped.
+pub struct PooledModule<'a, 'gm> {
+    pool: &'a ModulePool,
+    module: Module<'gm>,
+}
+impl<'gm> Deref for PooledModule<'_, 'gm> {
+    type Target = Module<'gm>;
+
+    fn deref(&self) -> &Self::Target {
+        &self.module
+    }
+}
+impl DerefMut for PooledModule<'_, '_> {
+    fn deref_mut(&mut self) -> &mut Self::Target {
+        &mut self.module
+    }
+}
+impl Drop for PooledModule<'_, '_> {
+    fn drop(&mut self) {
+        static RESET: LazyLock<AtomicPtr<scm_unused_struct>> = LazyLock::new(|| {
+            let guile = unsafe { Guile::new_unchecked_ref() };
+            let module =
+                Module::resolve(&List::from_iter([Symbol::from_str("guile", guile)], guile))
+                    .expect("`(guile)` should always exist");
+            let reset = unsafe {
+                guile.eval_in::<Scm>(
+                    &String::from_str(
+                        "(lambda (module)
+                           (hash-clear! (module-obarray module))
+                           (set-module-public-interface! module #f)
+                           (set-module-uses! module '())
+                           (hash-clear! (module-import-obarray module))
+                           (set-module-binder! module #f)
+                           (set-module-transformer! module #f)
+                           (set-module-duplicates-handlers! module #f)
+                           (set-module-observers! module '())
+                           (hash-clear! (module-weak-observers module))
+                           (hash-clear! (module-submodules module))
+                           (beautify-user-module! module))",
+                        guile,
+                    ),
+                    &module,
+                )
+            }
+            .expect("any object can be converted to a `Scm`");
+            unsafe { scm_gc_protect_object(reset.as_ptr()) }.into()
+        });
+
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        let mut reset = Proc::try_from_scm(
+            Scm::from_ptr(RESET.load(atomic::Ordering::Acquire), guile),
+            guile,
+        )
+        .expect("the module reset should be a procedure");
+        let module = self.module.0.as_ptr();
+        // tenant code may have broken the module badly enough for the reset to throw, which must not unwind through `drop`
+        let reset = guile.try_catch(
+            Tag::All,
+            |_| unsafe { reset.call::<1, _, Scm>((Scm::from_ptr(module, guile),)) },
+            |_, _, _| (),
+        );
+        // compiled procedures have already resolved this tenant's variables
+        unsafe { forget_compiled_procs(module) };
+        if reset.is_ok() {
+            self.pool.modules.lock().push(module as usize);
+        } else {
+            unsafe { scm_gc_unprotect_object(module) };
+        }
+    }
+}
@@ -17,6 +17,9 @@
 
 //! Implementation of traits for tuples
 //!
+//! Tuples of up to four elements are converted into lists and longer tuples into vectors.
+//! They can be converted back from either a list or a vector of the same length, reading every element in a single pass before checking and converting it.
+//!
 //! # Examples
 //! ```
 //! # use garguile::{module::Module, string::String, subr::{GuileFn, guile_fn}, symbol::Symbol, with_guile};
@@ -32,20 +35,83 @@
 //!         unsafe { guile.eval::<i32>(&String::from_str("(sum-u8-i32 '(10 -10))", guile)) },
 //!         Ok(0),
 //!     );
+//!     assert_eq!(
+//!         unsafe { guile.eval::<i32>(&String::from_str("(sum-u8-i32 #(10 -10))", guile)) },
+//!         Ok(0),
+//!     );
+//!     assert!(unsafe { guile.eval::<(u8, i32)>(&String::from_str("'(10 -10 0)", guile)) }.is_err());
+//!     assert!(unsafe { guile.eval::<(u8, i32)>(&String::from_str("#(10)", guile)) }.is_err());
+//!     assert!(unsafe { guile.eval::<(u8, i32)>(&String::from_str("'(10 . -10)", guile)) }.is_err());
+//!
+//!     Module::current(guile).define(Symbol::from_str("pair", guile), (1, 2));
+//!     Module::current(guile).define(Symbol::from_str("quintuple", guile), (1, 2, 3, 4, 5));
+//!     assert_eq!(unsafe { guile.eval::<bool>(&String::from_str("(equal? pair '(1 2))", guile)) }, Ok(true));
+//!     assert_eq!(unsafe { guile.eval::<bool>(&String::from_str("(equal? quintuple #(1 2 3 4 5))", guile)) }, Ok(true));
 //! })
 //! .unwrap();
 //! ```
 
-use crate::{list, scm::Scm};
+use {
+    crate::{
+        scm::Scm,
+        sys::{
+            SCM, SCM_BOOL_F, SCM_EOL, scm_c_make_vector, scm_c_vector_length, scm_c_vector_ref,
+            scm_c_vector_set_x, scm_car, scm_cdr, scm_cons, scm_is_pair, scm_is_vector,
+        },
+        utils::c_predicate,
+    },
+    std::array,
+};
 
-macro_rules! cons_ty {
-    () => {
-        $crate::collections::list::Null
-    };
-    ($car:ty $(, $($cdr:ty),+ $(,)?)?) => {
-        $crate::collections::pair::Pair<$car, cons_ty!($($($cdr),+)?)>
-    };
+/// Read the elements of a list or vector with exactly `N` elements.
+///
+/// # Safety
+///
+/// You must be in guile mode.
+unsafe fn elements<const N: usize>(scm: SCM) -> Option<[SCM; N]> {
+    if c_predicate(unsafe { scm_is_vector(scm) }) {
+        (unsafe { scm_c_vector_length(scm) } == N)
+            .then(|| array::from_fn(|i| unsafe { scm_c_vector_ref(scm, i) }))
+    } else {
+        let mut elements = [unsafe { SCM_EOL }; N];
+        let mut rest = scm;
+        for element in elements.iter_mut() {
+            if !c_predicate(unsafe { scm_is_pair(rest) }) {
+                return None;
+            }
+            *element = unsafe { scm_car(rest) };
+            rest = unsafe { scm_cdr(rest) };
+        }
+
+        (rest == unsafe { SCM_EOL }).then_some(elements)
+    }
+}
+
+/// Tuples with more elements than this are converted into vectors instead of lists.
+const LIST_LEN_MAX: usize = 4;
+
+/// Build a list from the elements, or a vector if there are more than [LIST_LEN_MAX].
+///
+/// # Safety
+///
+/// You must be in guile mode.
+unsafe fn from_elements<const N: usize>(elements: [SCM; N]) -> SCM {
+    if N > LIST_LEN_MAX {
+        let vector = unsafe { scm_c_make_vector(N, SCM_BOOL_F) };
+        for (i, element) in elements.into_iter().enumerate() {
+            unsafe {
+                scm_c_vector_set_x(vector, i, element);
+            }
+        }
+        vector
+    } else {
+        elements
+            .into_iter()
+            .rev()
+            .fold(unsafe { SCM_EOL }, |cdr, car| unsafe { scm_cons(car, cdr) })
+    }
 }
+
 macro_rules! impl_tuple {
     () => {
         impl<'gm> $crate::scm::ToScm<'gm> for () {
@@ -65,28 +131,31 @@ macro_rules! impl_tuple {
             unsafe fn from_scm_unchecked(_: $crate::scm::Scm<'gm>, _: &'gm $crate::Guile) -> Self {}
         }
     };
-    ($car:ident $(, $($cdr:ident),+ $(,)?)?) => {
-        impl<'gm, $car, $($($cdr),*)?> $crate::scm::ToScm<'gm> for ($car, $( $($cdr),+)?)
+    ($car:ident $(, $cdr:ident)* $(,)?) => {
+        impl<'gm, $car, $($cdr),*> $crate::scm::ToScm<'gm> for ($car, $($cdr,)*)
         where
             $car: $crate::scm::ToScm<'gm>,
-            $($($cdr: $crate::scm::ToScm<'gm>),+)?
+            $($cdr: $crate::scm::ToScm<'gm>,)*
         {
             fn to_scm(self, guile: &'gm $crate::Guile) -> Scm<'gm> {
                 #[expect(non_snake_case)]
-                let ($car, $( $($cdr),+)?) = self;
+                let ($car, $($cdr,)*) = self;
 
-                let lst: $crate::collections::list::List<Scm<'gm>> = list!(
+                Scm::from_ptr(
+                    unsafe {
+                        from_elements([
+                            $crate::reference::ReprScm::as_ptr(&<$car as $crate::scm::ToScm>::to_scm($car, guile)),
+                            $($crate::reference::ReprScm::as_ptr(&<$cdr as $crate::scm::ToScm>::to_scm($cdr, guile)),)*
+                        ])
+                    },
                     guile,
-                    <$car as $crate::scm::ToScm>::to_scm($car, guile),
-                    $($(<$cdr as $crate::scm::ToScm>::to_scm($cdr, guile)),+)?
-                );
-                lst.to_scm(guile)
+                )
             }
         }
-        impl<'gm, $car, $($($cdr),*)?> $crate::scm::TryFromScm<'gm> for ($car, $( $($cdr),+)?)
+        impl<'gm, $car, $($cdr),*> $crate::scm::TryFromScm<'gm> for ($car, $($cdr,)*)
         where
             $car: $crate::scm::TryFromScm<'gm>,
-            $($($cdr: $crate::scm::TryFromScm<'gm>),+)?
+            $($cdr: $crate::scm::TryFromScm<'gm>,)*
         {
             fn type_name() -> ::std::borrow::Cow<'static, ::std::ffi::CStr> {
                 #[allow(unused_macros)]
@@ -94,31 +163,54 @@ macro_rules! impl_tuple {
                     ($fst:literal $drop:tt) => { $fst };
                 }
                 ::std::ffi::CString::new(format!(
-                    concat!("'(", "{}", $($(add_string!(" " $cdr), add_string!("{}" $cdr),)+)? ")"),
+                    concat!("'(", "{}", $(add_string!(" " $cdr), add_string!("{}" $cdr),)* ")"),
                     $crate::reexports::bstr::BStr::new(<$car as $crate::scm::TryFromScm>::type_name().as_ref().to_bytes()),
-                    $($($crate::reexports::bstr::BStr::new(<$cdr as $crate::scm::TryFromScm>::type_name().as_ref().to_bytes()),)+)?
+                    $($crate::reexports::bstr::BStr::new(<$cdr as $crate::scm::TryFromScm>::type_name().as_ref().to_bytes()),)*
                 ))
                     .map(::std::borrow::Cow::Owned)
                     .unwrap_or(::std::borrow::Cow::Borrowed(c"list"))
             }
 
+            #[expect(non_snake_case)]
             fn predicate(scm: &$crate::scm::Scm<'gm>, guile: &'gm $crate::Guile) -> bool {
-                <cons_ty!($car $(, $($cdr),+)?)>::predicate(scm, guile)
+                unsafe { elements($crate::reference::ReprScm::as_ptr(scm)) }.is_some_and(|[$car, $($cdr),*]| {
+                    <$car as $crate::scm::TryFromScm>::predicate(&Scm::from_ptr($car, guile), guile)
+                        $(&& <$cdr as $crate::scm::TryFromScm>::predicate(&Scm::from_ptr($cdr, guile), guile))*
+                })
             }
 
             #[expect(non_snake_case)]
-            unsafe fn from_scm_unchecked(scm: $crate::scm::Scm<'gm>, guile: &'gm $crate::Guile) -> Self {
-                let mut iter = unsafe { $crate::collections::list::List::<$crate::scm::Scm>::from_scm_unchecked(scm, guile) }
-                .into_iter();
+            fn try_from_scm(scm: $crate::scm::Scm<'gm>, guile: &'gm $crate::Guile) -> Result<Self, $crate::scm::Scm<'gm>> {
+                let Some([$car, $($cdr),*]) = (unsafe { elements($crate::reference::ReprScm::as_ptr(&scm)) }) else {
+                    return Err(scm);
+                };
+                let ($car, $($cdr,)*) = (Scm::from_ptr($car, guile), $(Scm::from_ptr($cdr, guile),)*);
+
+                if <$car as $crate::scm::TryFromScm>::predicate(&$car, guile)
+                    $(&& <$cdr as $crate::scm::TryFromScm>::predicate(&$cdr, guile))*
+                {
+                    Ok((
+                        unsafe { <$car as $crate::scm::TryFromScm>::from_scm_unchecked($car, guile) },
+                        $(unsafe { <$cdr as $crate::scm::TryFromScm>::from_scm_unchecked($cdr, guile) },)*
+                    ))
+                } else {
+                    Err(scm)
+                }
+            }
 
-                let $car = iter.next().map(|scm| unsafe { $car::from_scm_unchecked(scm, guile) }).unwrap();
-                $($(let $cdr = iter.next().map(|scm| unsafe { $cdr::from_scm_unchecked(scm, guile) }).unwrap();)+)?
+            #[expect(non_snake_case)]
+            unsafe fn from_scm_unchecked(scm: $crate::scm::Scm<'gm>, guile: &'gm $crate::Guile) -> Self {
+                let [$car, $($cdr),*] = unsafe { elements($crate::reference::ReprScm::as_ptr(&scm)) }
+                    .expect("`predicate` should have checked the length");
 
-                ($car, $($($cdr),+)?)
+                (
+                    unsafe { <$car as $crate::scm::TryFromScm>::from_scm_unchecked(Scm::from_ptr($car, guile), guile) },
+                    $(unsafe { <$cdr as $crate::scm::TryFromScm>::from_scm_unchecked(Scm::from_ptr($cdr, guile), guile) },)*
+                )
             }
         }
 
-        impl_tuple!($($($cdr),*)?);
+        impl_tuple!($($cdr),*);
     };
 }
 impl_tuple!(A, B, C, D, E, F, G, H, I, J, K, L);
@@ -0,0 +1,198 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Rust structs represented as guile records.
+
+use {
+    crate::{
+        Guile,
+        collections::list::List,
+        module::Module,
+        reference::ReprScm,
+        scm::{Scm, ToScm},
+        symbol::Symbol,
+        sys::{
+            SCM, scm_c_public_ref, scm_call_n, scm_gc_protect_object, scm_struct_p, scm_struct_ref,
+            scm_struct_vtable,
+        },
+        utils::scm_predicate,
+    },
+    std::ffi::CStr,
+};
+
+/// Structs that are converted into guile records with `#[scm_repr = "record"]`.
+///
+/// Fields are stored in the order they are declared, so scheme code can read them with `struct-ref` or the accessors [Record::define_in] defines.
+/// The record type is cached once per struct, so it cannot be derived for structs with type or const parameters.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{module::Module, record::Record, scm::{ToScm, TryFromScm}, string::String, symbol::Symbol, with_guile};
+/// #[derive(Clone, Copy, Debug, PartialEq, Record, ToScm, TryFromScm)]
+/// #[scm_repr = "record"]
+/// struct Point {
+///     x: i32,
+///     y: i32,
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let mut module = Module::current(guile);
+///     module.define(Symbol::from_str("point", guile), Point { x: 1, y: 2 });
+///     module.define(Symbol::from_str("<point>", guile), Point::record_type(guile));
+///     assert_eq!(unsafe { guile.eval::<i32>(&String::from_str("((record-accessor <point> 'y) point)", guile)) }, Ok(2));
+///     assert_eq!(unsafe { guile.eval::<Point>(&String::from_str("((record-constructor <point>) 3 4)", guile)) }, Ok(Point { x: 3, y: 4 }));
+///     assert!(unsafe { guile.eval::<Point>(&String::from_str("((record-constructor <point>) 3 #f)", guile)) }.is_err());
+/// }).unwrap();
+/// ```
+///
+/// ```
+/// # use garguile::{module::Module, record::Record, scm::{ToScm, TryFromScm}, string::String, symbol::Symbol, with_guile};
+/// #[derive(Clone, Copy, Debug, PartialEq, Record, ToScm, TryFromScm)]
+/// #[scm_repr = "record"]
+/// struct Point {
+///     x: i32,
+///     y: i32,
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let mut module = Module::current(guile);
+///     Point::define_in(&mut module, guile);
+///     module.define(Symbol::from_str("origin", guile), Point { x: 0, y: 0 });
+///     assert_eq!(unsafe { guile.eval::<i32>(&String::from_str("(point-y (make-point 1 2))", guile)) }, Ok(2));
+///     assert_eq!(unsafe { guile.eval::<bool>(&String::from_str("(point? origin)", guile)) }, Ok(true));
+/// }).unwrap();
+/// ```
+///
+/// ```compile_fail
+/// # use garguile::record::Record;
+/// #[derive(Record)]
+/// struct Wrapper<T> {
+///     inner: T,
+/// }
+/// ```
+pub trait Record {
+    /// Get or create the record type descriptor.
+    ///
+    /// # Safety
+    ///
+    /// Only call in guile mode.
+    unsafe fn get_or_create_type() -> SCM;
+    /// Get the constructor of the record type, which takes every field in order.
+    ///
+    /// # Safety
+    ///
+    /// Only call in guile mode.
+    unsafe fn constructor() -> SCM;
+
+    /// Name of the record type in kebab case.
+    const NAME: &'static str;
+    /// Names of the fields in kebab case, in the order they are stored.
+    const FIELDS: &'static [&'static str];
+
+    /// Get the record type descriptor.
+    fn record_type<'gm>(guile: &'gm Guile) -> Scm<'gm> {
+        Scm::from_ptr(unsafe { Self::get_or_create_type() }, guile)
+    }
+
+    /// Define the bindings `define-record-type` would make in a module, so scheme code doesn't need to look them up at runtime.
+    ///
+    /// These are the type `<name>`, the constructor `make-name`, the predicate `name?` and an accessor `name-field` for every field.
+    fn define_in<'gm>(module: &mut Module<'gm>, guile: &'gm Guile) {
+        let rtd = unsafe { Self::get_or_create_type() };
+        let mut define = |name: std::string::String, val: SCM| {
+            module.define(Symbol::from_str(&name, guile), Scm::from_ptr(val, guile));
+        };
+
+        define(format!("<{}>", Self::NAME), rtd);
+        define(format!("make-{}", Self::NAME), unsafe {
+            Self::constructor()
+        });
+        define(format!("{}?", Self::NAME), unsafe {
+            call(c"record-predicate", &mut [rtd])
+        });
+        Self::FIELDS.iter().for_each(|field| {
+            let accessor = unsafe {
+                call(
+                    c"record-accessor",
+                    &mut [rtd, Symbol::from_str(field, guile).as_ptr()],
+                )
+            };
+            define(format!("{}-{field}", Self::NAME), accessor);
+        });
+    }
+}
+pub use garguile_proc_macros::Record;
+
+/// Create a record type that is never garbage collected.
+///
+/// # Safety
+///
+/// You must be in guile mode.
+#[doc(hidden)]
+pub unsafe fn make_record_type(name: &str, fields: &[&str]) -> SCM {
+    let guile = unsafe { Guile::new_unchecked_ref() };
+    let mut args = [
+        Symbol::from_str(name, guile).as_ptr(),
+        List::from_iter(
+            fields
+                .iter()
+                .rev()
+                .map(|field| Symbol::from_str(field, guile)),
+            guile,
+        )
+        .as_ptr(),
+    ];
+
+    unsafe { scm_gc_protect_object(call(c"make-record-type", &mut args)) }
+}
+/// Get the constructor of a record type that is never garbage collected.
+///
+/// # Safety
+///
+/// You must be in guile mode and `rtd` must be a record type.
+#[doc(hidden)]
+pub unsafe fn record_constructor(rtd: SCM) -> SCM {
+    unsafe { scm_gc_protect_object(call(c"record-constructor", &mut [rtd])) }
+}
+unsafe fn call(name: &CStr, args: &mut [SCM]) -> SCM {
+    unsafe {
+        scm_call_n(
+            scm_c_public_ref(c"guile".as_ptr(), name.as_ptr()),
+            args.as_mut_ptr(),
+            args.len(),
+        )
+    }
+}
+
+/// Check if `obj` is an instance of `rtd`.
+///
+/// # Safety
+///
+/// You must be in guile mode.
+#[doc(hidden)]
+pub unsafe fn is_a(obj: SCM, rtd: SCM) -> bool {
+    scm_predicate(unsafe { scm_struct_p(obj) }) && unsafe { scm_struct_vtable(obj) } == rtd
+}
+/// Read field `i` of a record.
+///
+/// # Safety
+///
+/// You must be in guile mode and `record` must have more than `i` fields.
+#[doc(hidden)]
+pub unsafe fn field(record: SCM, i: usize) -> SCM {
+    let guile = unsafe { Guile::new_unchecked_ref() };
+    unsafe { scm_struct_ref(record, i.to_scm(guile).as_ptr()) }
+}
@@ -49,6 +49,16 @@ int GARGUILE_REEXPORTS_SCM_UNBNDP(SCM scm) {
   return SCM_UNBNDP(scm);
 }
 
+int GARGUILE_REEXPORTS_SCM_HASHTABLE_P(SCM obj) {
+  return SCM_HASHTABLE_P(obj);
+}
+SCM GARGUILE_REEXPORTS_SCM_HASHTABLE_VECTOR(SCM table) {
+  return SCM_HASHTABLE_VECTOR(table);
+}
+unsigned long GARGUILE_REEXPORTS_SCM_HASHTABLE_N_ITEMS(SCM table) {
+  return SCM_HASHTABLE_N_ITEMS(table);
+}
+
 uintptr_t garguile_reexports_scm_to_uintptr_t(SCM scm) {
   return scm_to_uintptr_t(scm);
 }
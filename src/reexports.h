@@ -38,6 +38,10 @@ extern int GARGUILE_REEXPORTS_SCM_HOOKP(SCM);
 extern int GARGUILE_REEXPORTS_SCM_MODULEP(SCM);
 extern int GARGUILE_REEXPORTS_SCM_UNBNDP(SCM);
 
+extern int GARGUILE_REEXPORTS_SCM_HASHTABLE_P(SCM);
+extern SCM GARGUILE_REEXPORTS_SCM_HASHTABLE_VECTOR(SCM);
+extern unsigned long GARGUILE_REEXPORTS_SCM_HASHTABLE_N_ITEMS(SCM);
+
 extern uintptr_t garguile_reexports_scm_to_uintptr_t(SCM);
 extern intptr_t garguile_reexports_scm_to_intptr_t(SCM);
 
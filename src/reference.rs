@@ -19,7 +19,7 @@ use {
     crate::{
         Guile,
         scm::{Scm, TryFromScm},
-        sys::SCM,
+        sys::{SCM, scm_remember_upto_here_1},
     },
     std::{
         marker::PhantomData,
@@ -191,6 +191,35 @@ where
     }
 }
 
+/// Keeps an object reachable until it is dropped.
+///
+/// Pointers into an object, like the elements of a vector, do not keep it alive, so hold this alongside them.
+#[derive(Debug)]
+pub struct KeepAlive<'gm> {
+    ptr: SCM,
+    _marker: PhantomData<&'gm ()>,
+}
+impl<'gm> KeepAlive<'gm> {
+    /// Keep an object alive until the guard is dropped.
+    pub fn new<T>(scm: &T) -> Self
+    where
+        T: ReprScm + 'gm,
+    {
+        Self {
+            ptr: scm.as_ptr(),
+            _marker: PhantomData,
+        }
+    }
+}
+impl Drop for KeepAlive<'_> {
+    fn drop(&mut self) {
+        // SAFETY: the lifetime is tied to a [Guile], so this is in guile mode
+        unsafe {
+            scm_remember_upto_here_1(self.ptr);
+        }
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use {super::*, std::ptr};
@@ -0,0 +1,282 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Keep scheme objects alive outside of guile mode.
+
+use {
+    crate::{
+        Guile,
+        collections::{list::List, vector::Vector},
+        module::Module,
+        reference::ReprScm,
+        scm::{Scm, TryFromScm},
+        string::String,
+        subr::Proc,
+        symbol::Symbol,
+        sys::{
+            SCM, SCM_BOOL_F, scm_array_handle_release, scm_c_make_vector, scm_gc_protect_object,
+            scm_gc_unprotect_object, scm_t_array_handle, scm_unused_struct,
+            scm_vector_writable_elements,
+        },
+    },
+    parking_lot::Mutex,
+    std::{
+        collections::HashMap,
+        fmt::{self, Debug, Formatter},
+        marker::PhantomData,
+        sync::{
+            LazyLock,
+            atomic::{self, AtomicPtr},
+        },
+    },
+};
+
+/// Number of roots in each protected vector.
+const CHUNK_LEN: usize = 64;
+
+/// Protected vectors and their unused slots.
+///
+/// Vectors are protected once for every [CHUNK_LEN] roots. Vectors without roots are unprotected by [Root::new] once there is more than one, so a single spare vector is kept around.
+struct Chunks {
+    /// Addresses of the unused slots and the vectors they belong to.
+    free: Vec<(usize, usize)>,
+    /// Number of slots in use for each vector.
+    used: HashMap<usize, usize>,
+    /// Number of vectors without slots in use.
+    empty: usize,
+}
+impl Chunks {
+    /// Take an unused slot.
+    fn take(&mut self) -> Option<(usize, usize)> {
+        let (vector, slot) = self.free.pop()?;
+        let used = self
+            .used
+            .get_mut(&vector)
+            .expect("free slots should have a vector");
+        if *used == 0 {
+            self.empty -= 1;
+        }
+        *used += 1;
+
+        Some((vector, slot))
+    }
+
+    /// Return a slot.
+    fn give(&mut self, vector: usize, slot: usize) {
+        self.free.push((vector, slot));
+        let used = self
+            .used
+            .get_mut(&vector)
+            .expect("slots should have a vector");
+        *used -= 1;
+        if *used == 0 {
+            self.empty += 1;
+        }
+    }
+
+    /// Forget all but one of the vectors without slots in use and return them to be unprotected.
+    fn take_empty(&mut self) -> Vec<usize> {
+        if self.empty < 2 {
+            return Vec::new();
+        }
+
+        let empty = self
+            .used
+            .iter()
+            .filter(|(_, used)| **used == 0)
+            .map(|(vector, _)| *vector)
+            .skip(1)
+            .collect::<Vec<_>>();
+        empty.iter().for_each(|vector| {
+            self.used.remove(vector);
+        });
+        self.free
+            .retain(|(vector, _)| self.used.contains_key(vector));
+        self.empty = 1;
+
+        empty
+    }
+}
+
+static CHUNKS: LazyLock<Mutex<Chunks>> = LazyLock::new(|| {
+    Mutex::new(Chunks {
+        free: Vec::new(),
+        used: HashMap::new(),
+        empty: 0,
+    })
+});
+
+/// Create a protected vector and return it with the addresses of its slots.
+///
+/// # Safety
+///
+/// You must be in guile mode.
+unsafe fn new_chunk() -> (usize, impl Iterator<Item = usize>) {
+    let vector = unsafe { scm_gc_protect_object(scm_c_make_vector(CHUNK_LEN, SCM_BOOL_F)) };
+
+    let mut handle = scm_t_array_handle::default();
+    let mut len = 0;
+    let mut step = 0;
+    // the elements stay put after the handle is released since the garbage collector does not move objects
+    let ptr = unsafe {
+        scm_vector_writable_elements(vector, &raw mut handle, &raw mut len, &raw mut step)
+    };
+    unsafe {
+        scm_array_handle_release(&raw mut handle);
+    }
+
+    (
+        vector as usize,
+        (0..len).map(move |i| ptr.wrapping_offset(step * i as isize) as usize),
+    )
+}
+
+/// Scheme type that can be kept in a [Root], named with its guile mode lifetime as `'static`.
+///
+/// # Safety
+///
+/// [Self::In] must be the same type with `'gm` as its guile mode lifetime, and objects of that type must not stop being of that type.
+pub unsafe trait Rooted {
+    /// The type in guile mode.
+    type In<'gm>: ReprScm;
+}
+macro_rules! impl_rooted {
+    ($($ty:ident),*) => {
+        $(unsafe impl Rooted for $ty<'static> {
+            type In<'gm> = $ty<'gm>;
+        })*
+    };
+}
+impl_rooted!(Scm, Proc, Symbol, Module, String);
+unsafe impl<T> Rooted for List<'static, T> {
+    type In<'gm> = List<'gm, T>;
+}
+unsafe impl<T> Rooted for Vector<'static, T> {
+    type In<'gm> = Vector<'gm, T>;
+}
+
+/// Scheme object that stays alive until it is dropped, even outside of guile mode.
+///
+/// Untyped roots are created with [Root::new], and typed roots with [Root::typed] give back their type without checking it again.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{root::Root, string::String, subr::Proc, with_guile};
+/// # #[cfg(not(miri))] {
+/// let root = with_guile(|guile| {
+///     Root::new(unsafe { guile.eval::<Proc>(&String::from_str("(lambda (x) (+ x 1))", guile)) }.unwrap(), guile)
+/// }).unwrap();
+/// let typed = with_guile(|guile| {
+///     Root::<Proc>::typed(unsafe { guile.eval::<Proc>(&String::from_str("(lambda (x) (* x 2))", guile)) }.unwrap(), guile)
+/// }).unwrap();
+/// with_guile(|guile| {
+///     let mut proc = root.get_as::<Proc>(guile).unwrap();
+///     assert_eq!(unsafe { proc.call((1,)) }, Ok(2));
+///     assert_eq!(unsafe { typed.get(guile).call((2,)) }, Ok(4));
+/// }).unwrap();
+/// # }
+/// ```
+pub struct Root<T = Scm<'static>> {
+    vector: usize,
+    slot: usize,
+    _marker: PhantomData<fn() -> T>,
+}
+impl Root {
+    /// Keep an object alive.
+    pub fn new<T>(value: T, guile: &Guile) -> Self
+    where
+        T: ReprScm,
+    {
+        unsafe { Self::from_ptr(value.as_ptr(), guile) }
+    }
+}
+impl<T> Root<T>
+where
+    T: Rooted,
+{
+    /// Keep an object alive along with its type.
+    pub fn typed<'gm>(value: T::In<'gm>, guile: &'gm Guile) -> Self {
+        unsafe { Self::from_ptr(value.as_ptr(), guile) }
+    }
+
+    /// # Safety
+    ///
+    /// `ptr` must be an object of type `T::In`.
+    unsafe fn from_ptr(ptr: SCM, _: &Guile) -> Self {
+        // the lock must not be held while calling into guile, since dropping roots takes it again.
+        let (slot, empty) = {
+            let mut chunks = CHUNKS.lock();
+            (chunks.take(), chunks.take_empty())
+        };
+        empty.into_iter().for_each(|vector| unsafe {
+            scm_gc_unprotect_object(vector as SCM);
+        });
+        let (vector, slot) = slot.unwrap_or_else(|| {
+            let (vector, mut chunk) = unsafe { new_chunk() };
+            let slot = chunk.next().expect("chunks should not be empty");
+            let mut chunks = CHUNKS.lock();
+            chunks.used.insert(vector, 1);
+            chunks.free.extend(chunk.map(|slot| (vector, slot)));
+            (vector, slot)
+        });
+        let root = Self {
+            vector,
+            slot,
+            _marker: PhantomData,
+        };
+        root.as_atomic().store(ptr, atomic::Ordering::Release);
+
+        root
+    }
+
+    fn as_atomic(&self) -> &AtomicPtr<scm_unused_struct> {
+        // SAFETY: the slot is only accessed through atomics while it belongs to this root.
+        unsafe { AtomicPtr::from_ptr(self.slot as *mut SCM) }
+    }
+
+    /// Get the object.
+    pub fn get<'gm>(&self, _: &'gm Guile) -> T::In<'gm> {
+        // SAFETY: the type was checked when the root was created
+        unsafe { ReprScm::from_ptr(self.as_atomic().load(atomic::Ordering::Acquire)) }
+    }
+
+    /// Get the object as a type.
+    pub fn get_as<'gm, U>(&self, guile: &'gm Guile) -> Result<U, Scm<'gm>>
+    where
+        U: TryFromScm<'gm>,
+    {
+        U::try_from_scm(
+            Scm::from_ptr(self.as_atomic().load(atomic::Ordering::Acquire), guile),
+            guile,
+        )
+    }
+}
+impl<T> Debug for Root<T> {
+    fn fmt(&self, f: &mut Formatter<'_>) -> fmt::Result {
+        f.debug_struct("Root")
+            .field("vector", &self.vector)
+            .field("slot", &self.slot)
+            .finish()
+    }
+}
+impl<T> Drop for Root<T> {
+    fn drop(&mut self) {
+        // the vector is only scanned by the garbage collector, so this does not need guile mode
+        unsafe { AtomicPtr::from_ptr(self.slot as *mut SCM) }
+            .store(unsafe { SCM_BOOL_F }, atomic::Ordering::Release);
+        CHUNKS.lock().give(self.vector, self.slot);
+    }
+}
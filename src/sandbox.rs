@@ -0,0 +1,210 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Evaluate untrusted code with `(ice-9 sandbox)`.
+
+use {
+    crate::{
+        Guile,
+        catch::Tag,
+        collections::list::List,
+        module::Module,
+        reference::ReprScm,
+        scm::{Scm, ToScm, TryFromScm},
+        string::String,
+        subr::Proc,
+        symbol::Symbol,
+        sys::{SCM, scm_c_public_ref, scm_gc_protect_object},
+    },
+    parking_lot::Mutex,
+    std::{ffi::CStr, sync::LazyLock, time::Duration},
+};
+
+/// Budgets of [Guile::eval_with_limits].
+#[derive(Clone, Copy, Debug)]
+pub struct Limits {
+    /// Wall time the evaluation may take.
+    pub time: Duration,
+    /// Bytes the evaluation may allocate.
+    pub allocation: usize,
+}
+impl Default for Limits {
+    /// The defaults of `eval-in-sandbox`, which are 0.1 seconds and `#e10e6` bytes.
+    fn default() -> Self {
+        Self {
+            time: Duration::from_millis(100),
+            allocation: 10_000_000,
+        }
+    }
+}
+
+/// Error of [Guile::eval_with_limits].
+#[derive(Debug)]
+pub enum EvalError<'gm> {
+    /// The time limit was exceeded.
+    TimeLimit,
+    /// The allocation limit was exceeded.
+    AllocationLimit,
+    /// An exception was thrown, including syntax errors and unbound variables.
+    Exception(Symbol<'gm>, List<'gm, Scm<'gm>>),
+    /// The result could not be converted.
+    WrongType(Scm<'gm>),
+}
+
+/// Procedures used by [Guile::eval_with_limits] that are created once.
+struct Sandbox {
+    /// Read, check and evaluate a string in a sandbox module under the limits, then clear the module's definitions.
+    eval: usize,
+    make_sandbox_module: usize,
+    all_pure_bindings: usize,
+    /// Sandbox modules that are not in use, since making one is the costly part of `eval-in-sandbox`.
+    modules: Mutex<Vec<usize>>,
+}
+static SANDBOX: LazyLock<Sandbox> = LazyLock::new(|| {
+    let guile = unsafe { Guile::new_unchecked_ref() };
+    let public = |name: &CStr| unsafe {
+        scm_gc_protect_object(scm_c_public_ref(c"ice-9 sandbox".as_ptr(), name.as_ptr())) as usize
+    };
+    let module = Module::resolve(&List::from_iter(
+        [
+            Symbol::from_str("ice-9", guile),
+            Symbol::from_str("sandbox", guile),
+        ],
+        guile,
+    ))
+    .expect("`(ice-9 sandbox)` should exist after looking up its bindings");
+    let eval = unsafe {
+        guile.eval_in::<Proc>(
+            &String::from_str(
+                "(lambda (source module time-limit allocation-limit)
+                   (dynamic-wind
+                     (lambda () #t)
+                     (lambda ()
+                       (call-with-time-and-allocation-limits time-limit allocation-limit
+                         (lambda ()
+                           (let* ((port (open-input-string source))
+                                  (expr (read port))
+                                  (trailing (read port)))
+                             (unless (eof-object? trailing)
+                               (scm-error 'read-error \"eval-with-limits\"
+                                          \"trailing data after the expression: ~S\"
+                                          (list trailing) #f))
+                             (eval expr module)))))
+                     (lambda () (hash-clear! (module-obarray module)))))",
+                guile,
+            ),
+            &module,
+        )
+    }
+    .expect("the sandbox evaluator should be a procedure");
+
+    Sandbox {
+        eval: unsafe { scm_gc_protect_object(eval.as_ptr()) } as usize,
+        make_sandbox_module: public(c"make-sandbox-module"),
+        all_pure_bindings: public(c"all-pure-bindings"),
+        modules: Mutex::new(Vec::new()),
+    }
+});
+
+impl Guile {
+    /// Evaluate an expression like `eval-in-sandbox`, which only allows pure bindings and stops after the limits.
+    ///
+    /// Instructions are not counted, so the time limit also bounds runaway loops.
+    /// Reading the expression counts towards the limits, and anything after the first expression is a `read-error`.
+    /// Sandbox modules are made once and reused, with their definitions cleared after every evaluation.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{sandbox::{EvalError, Limits}, string::String, with_guile};
+    /// # use std::time::Duration;
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     assert_eq!(guile.eval_with_limits::<i32>(&String::from_str("(+ 1 2)", guile), Limits::default()).unwrap(), 3);
+    ///     assert!(matches!(
+    ///         guile.eval_with_limits::<i32>(&String::from_str("(let loop () (loop))", guile), Limits::default()),
+    ///         Err(EvalError::TimeLimit),
+    ///     ));
+    ///     let limits = Limits { time: Duration::from_secs(10), allocation: 1024 * 1024 };
+    ///     assert!(matches!(
+    ///         guile.eval_with_limits::<i32>(&String::from_str("(length (make-list 10000000 0))", guile), limits),
+    ///         Err(EvalError::AllocationLimit),
+    ///     ));
+    ///     assert!(matches!(
+    ///         guile.eval_with_limits::<i32>(&String::from_str("(delete-file \"/\")", guile), Limits::default()),
+    ///         Err(EvalError::Exception(..)),
+    ///     ));
+    ///     assert!(matches!(
+    ///         guile.eval_with_limits::<i32>(&String::from_str("1 (delete-file \"/\")", guile), Limits::default()),
+    ///         Err(EvalError::Exception(..)),
+    ///     ));
+    ///     let _ = guile.eval_with_limits::<i32>(&String::from_str("(begin (define leaked 1) leaked)", guile), Limits::default());
+    ///     assert!(matches!(
+    ///         guile.eval_with_limits::<i32>(&String::from_str("leaked", guile), Limits::default()),
+    ///         Err(EvalError::Exception(..)),
+    ///     ));
+    /// }).unwrap();
+    /// ```
+    pub fn eval_with_limits<'gm, T>(
+        &'gm self,
+        str: &String<'gm>,
+        limits: Limits,
+    ) -> Result<T, EvalError<'gm>>
+    where
+        T: TryFromScm<'gm>,
+    {
+        let scm = |ptr: usize| Scm::from_ptr(ptr as SCM, self);
+        let proc = |ptr: usize| unsafe { Proc::from_scm_unchecked(scm(ptr), self) };
+
+        let module = SANDBOX.modules.lock().pop().map_or_else(
+            || unsafe {
+                let module = proc(SANDBOX.make_sandbox_module)
+                    .call::<1, _, Scm>((scm(SANDBOX.all_pure_bindings),))
+                    .expect("any object can be converted to a `Scm`");
+                scm_gc_protect_object(module.as_ptr()) as usize
+            },
+            |module| module,
+        );
+        let output = self.try_catch(
+            Tag::All,
+            |guile| {
+                unsafe {
+                    proc(SANDBOX.eval).call::<4, _, Scm>((
+                        Scm::from_ptr(str.as_ptr(), guile),
+                        scm(module),
+                        limits.time.as_secs_f64(),
+                        limits.allocation,
+                    ))
+                }
+                .expect("any object can be converted to a `Scm`")
+            },
+            |guile, key, args| {
+                if key.as_ptr() != Symbol::from_str("limit-exceeded", guile).as_ptr() {
+                    EvalError::Exception(key, args)
+                } else if args.iter().next().is_some_and(|subr| {
+                    *subr == String::from_str("with-time-limit", guile).to_scm(guile)
+                }) {
+                    EvalError::TimeLimit
+                } else {
+                    EvalError::AllocationLimit
+                }
+            },
+        );
+        // the evaluator clears the module's definitions even when it throws
+        SANDBOX.modules.lock().push(module);
+
+        output.and_then(|output| T::try_from_scm(output, self).map_err(EvalError::WrongType))
+    }
+}
@@ -19,10 +19,7 @@ use {
     crate::{
         Guile,
         reference::ReprScm,
-        sys::{
-            SCM, SCM_UNBNDP, scm_equal_p, scm_is_false, scm_is_true, scm_null_p,
-            scm_wrong_type_arg_msg,
-        },
+        sys::{SCM, SCM_UNBNDP, scm_equal_p, scm_is_true, scm_null_p, scm_wrong_type_arg_msg},
         utils::{c_predicate, scm_predicate},
     },
     std::{borrow::Cow, ffi::CStr, marker::PhantomData},
@@ -162,9 +159,6 @@ impl<'gm> Scm<'gm> {
     pub(crate) fn is_true(&self) -> bool {
         c_predicate(unsafe { scm_is_true(self.as_ptr()) })
     }
-    pub(crate) fn is_false(&self) -> bool {
-        c_predicate(unsafe { scm_is_false(self.as_ptr()) })
-    }
     pub(crate) fn is_eol(&self) -> bool {
         scm_predicate(unsafe { scm_null_p(self.as_ptr()) })
     }
@@ -0,0 +1,155 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Conversions between scheme data and anything implementing [Serialize] or [Deserialize][::serde::Deserialize].
+//!
+//! Data is mapped as follows:
+//!
+//! | rust                                  | scheme                                        |
+//! |---------------------------------------|-----------------------------------------------|
+//! | `bool`                                | boolean                                       |
+//! | integers and floats                   | number                                        |
+//! | `char`                                | character                                     |
+//! | `str`                                 | string                                        |
+//! | bytes                                 | bytevector                                    |
+//! | `None`, `()` and unit structs         | the symbol `null`                             |
+//! | `Some` and newtype structs            | the inner value                               |
+//! | sequences                             | list                                          |
+//! | tuples and tuple structs              | vector                                        |
+//! | maps                                  | hash table compared with `equal?`             |
+//! | structs                               | association list keyed by field symbols       |
+//! | unit variants                         | symbol                                        |
+//! | newtype, tuple and struct variants    | list headed by a symbol followed by the data  |
+//!
+//! Deserializing accepts either a list or a vector for sequences and tuples, and either a hash table or an association list for maps and structs.
+//! Field and variant names are used as they are, so `#[serde(rename_all = "kebab-case")]` gives them the usual scheme spelling.
+//!
+//! # Examples
+//!
+//! ```
+//! # use garguile::{serde::{from_scm, to_scm}, string::String, with_guile};
+//! # use serde::{Deserialize, Serialize};
+//! # use std::collections::BTreeMap;
+//! #[derive(Debug, Deserialize, PartialEq, Serialize)]
+//! #[serde(rename_all = "kebab-case")]
+//! enum Shape {
+//!     Point,
+//!     Circle { radius: f64 },
+//! }
+//! #[derive(Debug, Deserialize, PartialEq, Serialize)]
+//! struct Scene {
+//!     name: std::string::String,
+//!     shapes: Vec<Shape>,
+//!     origin: (i32, i32),
+//!     tags: BTreeMap<std::string::String, u8>,
+//!     parent: Option<u32>,
+//! }
+//! # #[cfg(not(miri))]
+//! with_guile(|guile| {
+//!     let scene = unsafe {
+//!         guile.eval(&String::from_str(
+//!             r#"'((name . "main") (shapes point (circle (radius . 2.5))) (origin . #(1 2)) (tags) (parent . null))"#,
+//!             guile,
+//!         ))
+//!     }
+//!     .unwrap();
+//!     let scene = from_scm::<Scene>(scene, guile).unwrap();
+//!     assert_eq!(
+//!         scene,
+//!         Scene {
+//!             name: "main".into(),
+//!             shapes: vec![Shape::Point, Shape::Circle { radius: 2.5 }],
+//!             origin: (1, 2),
+//!             tags: BTreeMap::new(),
+//!             parent: None,
+//!         },
+//!     );
+//!     assert_eq!(from_scm::<Scene>(to_scm(&scene, guile).unwrap(), guile), Ok(scene));
+//! }).unwrap();
+//! ```
+
+mod de;
+mod ser;
+
+pub use {de::Deserializer, ser::Serializer};
+
+use {
+    crate::{Guile, scm::Scm},
+    ::serde::{Serialize, de::DeserializeOwned},
+    std::fmt::{self, Display, Formatter},
+};
+
+/// Error raised while serializing or deserializing.
+#[derive(Clone, Debug, PartialEq)]
+pub struct Error(std::string::String);
+impl Display for Error {
+    fn fmt(&self, f: &mut Formatter<'_>) -> fmt::Result {
+        f.write_str(&self.0)
+    }
+}
+impl std::error::Error for Error {}
+impl ::serde::ser::Error for Error {
+    fn custom<T>(msg: T) -> Self
+    where
+        T: Display,
+    {
+        Self(msg.to_string())
+    }
+}
+impl ::serde::de::Error for Error {
+    fn custom<T>(msg: T) -> Self
+    where
+        T: Display,
+    {
+        Self(msg.to_string())
+    }
+}
+
+/// Serialize a value into scheme data.
+pub fn to_scm<'gm, T>(value: &T, guile: &'gm Guile) -> Result<Scm<'gm>, Error>
+where
+    T: Serialize + ?Sized,
+{
+    value.serialize(Serializer::new(guile))
+}
+
+/// Deserialize a value from scheme data.
+///
+/// # Examples
+///
+/// Self-describing formats like untagged enums go through the type of the data, so tuples come back from their vectors.
+///
+/// ```
+/// # use garguile::{serde::{from_scm, to_scm}, with_guile};
+/// # use serde::{Deserialize, Serialize};
+/// #[derive(Debug, Deserialize, PartialEq, Serialize)]
+/// #[serde(untagged)]
+/// enum Value {
+///     Pair((i32, bool)),
+///     Text(std::string::String),
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let pair = Value::Pair((1, true));
+///     assert_eq!(from_scm::<Value>(to_scm(&pair, guile).unwrap(), guile), Ok(pair));
+///     assert_eq!(from_scm::<(i32, bool)>(to_scm(&(2, false), guile).unwrap(), guile), Ok((2, false)));
+/// }).unwrap();
+/// ```
+pub fn from_scm<'gm, T>(scm: Scm<'gm>, guile: &'gm Guile) -> Result<T, Error>
+where
+    T: DeserializeOwned,
+{
+    T::deserialize(Deserializer::new(scm, guile))
+}
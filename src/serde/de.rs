@@ -0,0 +1,424 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Deserializer that walks scheme data in place.
+
+use {
+    crate::{
+        Guile,
+        alloc::CAllocator,
+        collections::{
+            byte_vector::ByteVector, hash_map::HashMap, list::List, pair::Pair, vector::Vector,
+        },
+        reference::ReprScm,
+        scm::{Scm, TryFromScm},
+        serde::Error,
+        string::String,
+        symbol::Symbol,
+        sys::{SCM_EOL, SCM_UNBNDP, scm_car, scm_cdr, scm_is_pair},
+        utils::c_predicate,
+    },
+    ::serde::de::{
+        self, DeserializeSeed, EnumAccess, Error as _, MapAccess, SeqAccess, Unexpected,
+        VariantAccess, Visitor,
+    },
+    ::string::String as BufString,
+    allocator_api2::vec::Vec,
+};
+
+/// Scheme data that has no serde equivalent, or that is not what the visitor expected.
+const OTHER: Unexpected<'static> = Unexpected::Other("scheme object");
+
+/// Deserializer that reads from a [Scm] without copying it into rust data first.
+pub struct Deserializer<'gm> {
+    scm: Scm<'gm>,
+    guile: &'gm Guile,
+}
+impl<'gm> Deserializer<'gm> {
+    /// Create a deserializer.
+    pub fn new(scm: Scm<'gm>, guile: &'gm Guile) -> Self {
+        Self { scm, guile }
+    }
+
+    fn get<T>(&self) -> Option<T>
+    where
+        T: TryFromScm<'gm>,
+    {
+        T::try_from_scm(Scm::from_ptr(self.scm.as_ptr(), self.guile), self.guile).ok()
+    }
+    fn is_null(&self) -> bool {
+        self.scm.as_ptr() == Symbol::from_str("null", self.guile).as_ptr()
+    }
+    /// Get the name of a symbol or the contents of a string.
+    fn name(&self) -> Option<BufString<Vec<u8, CAllocator>>> {
+        self.get::<Symbol>()
+            .map(String::from)
+            .or_else(|| self.get::<String>())
+            .map(|name| name.as_string())
+    }
+}
+
+fn visit_alist<'de, 'gm, V>(
+    list: List<'gm, Scm<'gm>>,
+    visitor: V,
+    guile: &'gm Guile,
+) -> Result<V::Value, Error>
+where
+    V: Visitor<'de>,
+{
+    visitor.visit_map(Map::new(
+        list.into_iter().map(move |entry| {
+            Pair::<Scm, Scm>::try_from_scm(entry, guile)
+                .map(Pair::to_tuple)
+                .map_err(|_| Error::custom("expected a pair in the association list"))
+        }),
+        guile,
+    ))
+}
+fn visit_hash_map<'de, 'gm, V>(
+    map: HashMap<'gm, Scm<'gm>, Scm<'gm>>,
+    visitor: V,
+    guile: &'gm Guile,
+) -> Result<V::Value, Error>
+where
+    V: Visitor<'de>,
+{
+    visitor.visit_map(Map::new(map.into_iter().map(Ok), guile))
+}
+
+impl<'de, 'gm> de::Deserializer<'de> for Deserializer<'gm> {
+    type Error = Error;
+
+    fn deserialize_any<V>(self, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        if let Some(b) = self.get::<bool>() {
+            visitor.visit_bool(b)
+        } else if let Some(i) = self.get::<i64>() {
+            visitor.visit_i64(i)
+        } else if let Some(u) = self.get::<u64>() {
+            visitor.visit_u64(u)
+        } else if let Some(f) = self.get::<f64>() {
+            visitor.visit_f64(f)
+        } else if let Some(ch) = self.get::<char>() {
+            visitor.visit_char(ch)
+        } else if self.is_null() {
+            visitor.visit_unit()
+        } else if let Some(name) = self.name() {
+            visitor.visit_str(&name)
+        } else if let Some(list) = self.get::<List<Scm>>() {
+            visitor.visit_seq(Seq::new(list.into_iter(), self.guile))
+        } else if let Some(pair) = self.get::<Pair<Scm, Scm>>() {
+            let (car, cdr) = pair.to_tuple();
+            visitor.visit_seq(Seq::new([car, cdr].into_iter(), self.guile))
+        } else if let Some(vector) = self.get::<Vector<Scm>>() {
+            visitor.visit_seq(Seq::new(vector.into_iter(), self.guile))
+        } else if let Some(map) = self.get::<HashMap<Scm, Scm>>() {
+            visit_hash_map(map, visitor, self.guile)
+        } else if let Some(bytes) = self.get::<ByteVector<u8>>() {
+            visitor.visit_byte_buf(bytes.iter().copied().collect())
+        } else {
+            Err(Error::invalid_type(OTHER, &visitor))
+        }
+    }
+
+    fn deserialize_bytes<V>(self, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        match self.get::<ByteVector<u8>>() {
+            Some(bytes) => visitor.visit_byte_buf(bytes.iter().copied().collect()),
+            None => self.deserialize_any(visitor),
+        }
+    }
+    fn deserialize_byte_buf<V>(self, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        self.deserialize_bytes(visitor)
+    }
+
+    fn deserialize_option<V>(self, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        if self.is_null() || c_predicate(unsafe { SCM_UNBNDP(self.scm.as_ptr()) }) {
+            visitor.visit_none()
+        } else {
+            visitor.visit_some(self)
+        }
+    }
+    fn deserialize_unit<V>(self, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        if self.is_null() {
+            visitor.visit_unit()
+        } else {
+            Err(Error::invalid_type(OTHER, &visitor))
+        }
+    }
+    fn deserialize_unit_struct<V>(self, _: &'static str, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        self.deserialize_unit(visitor)
+    }
+    fn deserialize_newtype_struct<V>(self, _: &'static str, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        visitor.visit_newtype_struct(self)
+    }
+
+    fn deserialize_map<V>(self, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        if let Some(map) = self.get::<HashMap<Scm, Scm>>() {
+            visit_hash_map(map, visitor, self.guile)
+        } else if let Some(list) = self.get::<List<Scm>>() {
+            visit_alist(list, visitor, self.guile)
+        } else {
+            Err(Error::invalid_type(OTHER, &visitor))
+        }
+    }
+    fn deserialize_struct<V>(
+        self,
+        _: &'static str,
+        _: &'static [&'static str],
+        visitor: V,
+    ) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        self.deserialize_map(visitor)
+    }
+
+    fn deserialize_enum<V>(
+        self,
+        _: &'static str,
+        _: &'static [&'static str],
+        visitor: V,
+    ) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        let ptr = self.scm.as_ptr();
+        if self.get::<Symbol>().is_some() {
+            visitor.visit_enum(Enum {
+                tag: self.scm,
+                data: None,
+                guile: self.guile,
+            })
+        } else if c_predicate(unsafe { scm_is_pair(ptr) }) {
+            visitor.visit_enum(Enum {
+                tag: Scm::from_ptr(unsafe { scm_car(ptr) }, self.guile),
+                data: Some(Scm::from_ptr(unsafe { scm_cdr(ptr) }, self.guile)),
+                guile: self.guile,
+            })
+        } else {
+            Err(Error::invalid_type(OTHER, &visitor))
+        }
+    }
+
+    fn deserialize_identifier<V>(self, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        match self.name() {
+            Some(name) => visitor.visit_str(&name),
+            None => self.deserialize_any(visitor),
+        }
+    }
+
+    ::serde::forward_to_deserialize_any! {
+        bool i8 i16 i32 i64 i128 u8 u16 u32 u64 u128 f32 f64 char str string
+        seq tuple tuple_struct ignored_any
+    }
+}
+
+/// Lazily deserialized elements of a list or vector.
+struct Seq<'gm, I> {
+    iter: I,
+    guile: &'gm Guile,
+}
+impl<'gm, I> Seq<'gm, I> {
+    fn new(iter: I, guile: &'gm Guile) -> Self {
+        Self { iter, guile }
+    }
+}
+impl<'de, 'gm, I> SeqAccess<'de> for Seq<'gm, I>
+where
+    I: Iterator<Item = Scm<'gm>>,
+{
+    type Error = Error;
+
+    fn next_element_seed<T>(&mut self, seed: T) -> Result<Option<T::Value>, Error>
+    where
+        T: DeserializeSeed<'de>,
+    {
+        self.iter
+            .next()
+            .map(|scm| seed.deserialize(Deserializer::new(scm, self.guile)))
+            .transpose()
+    }
+
+    fn size_hint(&self) -> Option<usize> {
+        match self.iter.size_hint() {
+            (lower, Some(upper)) if lower == upper => Some(upper),
+            _ => None,
+        }
+    }
+}
+
+/// Lazily deserialized entries of a hash table or association list.
+struct Map<'gm, I> {
+    iter: I,
+    value: Option<Scm<'gm>>,
+    guile: &'gm Guile,
+}
+impl<'gm, I> Map<'gm, I> {
+    fn new(iter: I, guile: &'gm Guile) -> Self {
+        Self {
+            iter,
+            value: None,
+            guile,
+        }
+    }
+}
+impl<'de, 'gm, I> MapAccess<'de> for Map<'gm, I>
+where
+    I: Iterator<Item = Result<(Scm<'gm>, Scm<'gm>), Error>>,
+{
+    type Error = Error;
+
+    fn next_key_seed<K>(&mut self, seed: K) -> Result<Option<K::Value>, Error>
+    where
+        K: DeserializeSeed<'de>,
+    {
+        self.iter
+            .next()
+            .transpose()?
+            .map(|(key, value)| {
+                self.value = Some(value);
+                seed.deserialize(Deserializer::new(key, self.guile))
+            })
+            .transpose()
+    }
+    fn next_value_seed<V>(&mut self, seed: V) -> Result<V::Value, Error>
+    where
+        V: DeserializeSeed<'de>,
+    {
+        let value = self
+            .value
+            .take()
+            .expect("`next_key_seed` should be called before `next_value_seed`");
+        seed.deserialize(Deserializer::new(value, self.guile))
+    }
+
+    fn size_hint(&self) -> Option<usize> {
+        match self.iter.size_hint() {
+            (lower, Some(upper)) if lower == upper => Some(upper),
+            _ => None,
+        }
+    }
+}
+
+/// Variant of an enum, which is either a symbol or a list headed by a symbol.
+struct Enum<'gm> {
+    tag: Scm<'gm>,
+    data: Option<Scm<'gm>>,
+    guile: &'gm Guile,
+}
+impl<'de, 'gm> EnumAccess<'de> for Enum<'gm> {
+    type Error = Error;
+    type Variant = Variant<'gm>;
+
+    fn variant_seed<V>(self, seed: V) -> Result<(V::Value, Variant<'gm>), Error>
+    where
+        V: DeserializeSeed<'de>,
+    {
+        let tag = Deserializer::new(self.tag, self.guile);
+        if tag.get::<Symbol>().is_none() {
+            return Err(Error::custom("expected a symbol naming the variant"));
+        }
+
+        seed.deserialize(tag).map(|variant| {
+            (
+                variant,
+                Variant {
+                    data: self.data,
+                    guile: self.guile,
+                },
+            )
+        })
+    }
+}
+
+/// Data that follows the symbol of a variant.
+struct Variant<'gm> {
+    data: Option<Scm<'gm>>,
+    guile: &'gm Guile,
+}
+impl<'gm> Variant<'gm> {
+    fn list(self) -> Result<List<'gm, Scm<'gm>>, Error> {
+        self.data
+            .and_then(|data| List::try_from_scm(data, self.guile).ok())
+            .ok_or_else(|| Error::custom("expected a list of variant data"))
+    }
+}
+impl<'de, 'gm> VariantAccess<'de> for Variant<'gm> {
+    type Error = Error;
+
+    fn unit_variant(self) -> Result<(), Error> {
+        match self.data {
+            Some(data) if data.as_ptr() != unsafe { SCM_EOL } => Err(Error::invalid_type(
+                Unexpected::TupleVariant,
+                &"unit variant",
+            )),
+            _ => Ok(()),
+        }
+    }
+    fn newtype_variant_seed<T>(self, seed: T) -> Result<T::Value, Error>
+    where
+        T: DeserializeSeed<'de>,
+    {
+        let guile = self.guile;
+        let mut list = self.list()?.into_iter();
+        match (list.next(), list.next()) {
+            (Some(value), None) => seed.deserialize(Deserializer::new(value, guile)),
+            _ => Err(Error::invalid_length(
+                1,
+                &"a single value after the variant",
+            )),
+        }
+    }
+    fn tuple_variant<V>(self, _: usize, visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        let guile = self.guile;
+        visitor.visit_seq(Seq::new(self.list()?.into_iter(), guile))
+    }
+    fn struct_variant<V>(self, _: &'static [&'static str], visitor: V) -> Result<V::Value, Error>
+    where
+        V: Visitor<'de>,
+    {
+        let guile = self.guile;
+        visit_alist(self.list()?, visitor, guile)
+    }
+}
@@ -0,0 +1,407 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Serializer that builds scheme data directly.
+
+use {
+    crate::{
+        Guile,
+        alloc::CAllocator,
+        collections::{byte_vector::ByteVector, hash_map::HashMap},
+        reference::ReprScm,
+        scm::{Scm, ToScm},
+        serde::Error,
+        string::String,
+        symbol::Symbol,
+        sys::{
+            SCM, SCM_BOOL_F, SCM_EOL, scm_c_make_vector, scm_c_vector_set_x, scm_cons,
+            scm_set_cdr_x,
+        },
+    },
+    ::serde::ser::{
+        self, Serialize, SerializeMap, SerializeSeq, SerializeStruct, SerializeStructVariant,
+        SerializeTuple, SerializeTupleStruct, SerializeTupleVariant,
+    },
+    allocator_api2::vec::Vec,
+};
+
+/// Serializer whose output is a [Scm].
+#[derive(Clone, Copy)]
+pub struct Serializer<'gm> {
+    guile: &'gm Guile,
+}
+impl<'gm> Serializer<'gm> {
+    /// Create a serializer.
+    pub fn new(guile: &'gm Guile) -> Self {
+        Self { guile }
+    }
+
+    fn symbol(self, name: &str) -> SCM {
+        Symbol::from_str(name, self.guile).as_ptr()
+    }
+    fn scm(self, ptr: SCM) -> Scm<'gm> {
+        Scm::from_ptr(ptr, self.guile)
+    }
+    fn null(self) -> Scm<'gm> {
+        self.scm(self.symbol("null"))
+    }
+}
+
+/// List built front to back by keeping a pointer to its last pair.
+struct ListBuilder {
+    head: SCM,
+    tail: SCM,
+}
+impl ListBuilder {
+    fn new() -> Self {
+        Self {
+            head: unsafe { SCM_EOL },
+            tail: unsafe { SCM_EOL },
+        }
+    }
+    fn push(&mut self, item: SCM) {
+        let pair = unsafe { scm_cons(item, SCM_EOL) };
+        if self.head == unsafe { SCM_EOL } {
+            self.head = pair;
+        } else {
+            unsafe {
+                scm_set_cdr_x(self.tail, pair);
+            }
+        }
+        self.tail = pair;
+    }
+}
+
+/// Serializer for sequences and variants, which become lists.
+pub struct SerializeList<'gm> {
+    serializer: Serializer<'gm>,
+    list: ListBuilder,
+}
+impl<'gm> SerializeList<'gm> {
+    fn push<T>(&mut self, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        let value = value.serialize(self.serializer)?;
+        self.list.push(value.as_ptr());
+        Ok(())
+    }
+    fn push_field<T>(&mut self, key: &'static str, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        let value = value.serialize(self.serializer)?;
+        self.list
+            .push(unsafe { scm_cons(self.serializer.symbol(key), value.as_ptr()) });
+        Ok(())
+    }
+    fn finish(self) -> Scm<'gm> {
+        self.serializer.scm(self.list.head)
+    }
+}
+impl<'gm> SerializeSeq for SerializeList<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    fn serialize_element<T>(&mut self, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        self.push(value)
+    }
+    fn end(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.finish())
+    }
+}
+impl<'gm> SerializeTupleVariant for SerializeList<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    fn serialize_field<T>(&mut self, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        self.push(value)
+    }
+    fn end(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.finish())
+    }
+}
+impl<'gm> SerializeStruct for SerializeList<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    fn serialize_field<T>(&mut self, key: &'static str, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        self.push_field(key, value)
+    }
+    fn end(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.finish())
+    }
+}
+impl<'gm> SerializeStructVariant for SerializeList<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    fn serialize_field<T>(&mut self, key: &'static str, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        self.push_field(key, value)
+    }
+    fn end(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.finish())
+    }
+}
+
+/// Serializer for tuples, which become vectors of a known length.
+pub struct SerializeVector<'gm> {
+    serializer: Serializer<'gm>,
+    vector: SCM,
+    idx: usize,
+}
+impl<'gm> SerializeVector<'gm> {
+    fn push<T>(&mut self, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        let value = value.serialize(self.serializer)?;
+        unsafe {
+            scm_c_vector_set_x(self.vector, self.idx, value.as_ptr());
+        }
+        self.idx += 1;
+        Ok(())
+    }
+}
+impl<'gm> SerializeTuple for SerializeVector<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    fn serialize_element<T>(&mut self, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        self.push(value)
+    }
+    fn end(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.serializer.scm(self.vector))
+    }
+}
+impl<'gm> SerializeTupleStruct for SerializeVector<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    fn serialize_field<T>(&mut self, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        self.push(value)
+    }
+    fn end(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.serializer.scm(self.vector))
+    }
+}
+
+/// Serializer for maps, which become hash tables.
+pub struct SerializeHashMap<'gm> {
+    serializer: Serializer<'gm>,
+    map: HashMap<'gm, Scm<'gm>, Scm<'gm>>,
+    key: Option<Scm<'gm>>,
+}
+impl<'gm> SerializeMap for SerializeHashMap<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    fn serialize_key<T>(&mut self, key: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        self.key = Some(key.serialize(self.serializer)?);
+        Ok(())
+    }
+    fn serialize_value<T>(&mut self, value: &T) -> Result<(), Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        let key = self
+            .key
+            .take()
+            .expect("`serialize_key` should be called before `serialize_value`");
+        self.map.insert(key, value.serialize(self.serializer)?);
+        Ok(())
+    }
+    fn end(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.map.to_scm(self.serializer.guile))
+    }
+}
+
+impl<'gm> ser::Serializer for Serializer<'gm> {
+    type Ok = Scm<'gm>;
+    type Error = Error;
+
+    type SerializeSeq = SerializeList<'gm>;
+    type SerializeTuple = SerializeVector<'gm>;
+    type SerializeTupleStruct = SerializeVector<'gm>;
+    type SerializeTupleVariant = SerializeList<'gm>;
+    type SerializeMap = SerializeHashMap<'gm>;
+    type SerializeStruct = SerializeList<'gm>;
+    type SerializeStructVariant = SerializeList<'gm>;
+
+    fn serialize_bool(self, v: bool) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_i8(self, v: i8) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_i16(self, v: i16) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_i32(self, v: i32) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_i64(self, v: i64) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_u8(self, v: u8) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_u16(self, v: u16) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_u32(self, v: u32) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_u64(self, v: u64) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_f32(self, v: f32) -> Result<Scm<'gm>, Error> {
+        Ok(f64::from(v).to_scm(self.guile))
+    }
+    fn serialize_f64(self, v: f64) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_char(self, v: char) -> Result<Scm<'gm>, Error> {
+        Ok(v.to_scm(self.guile))
+    }
+    fn serialize_str(self, v: &str) -> Result<Scm<'gm>, Error> {
+        Ok(String::from_str(v, self.guile).to_scm(self.guile))
+    }
+    fn serialize_bytes(self, v: &[u8]) -> Result<Scm<'gm>, Error> {
+        let mut vec = Vec::with_capacity_in(v.len(), CAllocator);
+        vec.extend_from_slice(v);
+        Ok(ByteVector::from(vec).to_scm(self.guile))
+    }
+
+    fn serialize_none(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.null())
+    }
+    fn serialize_some<T>(self, value: &T) -> Result<Scm<'gm>, Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        value.serialize(self)
+    }
+    fn serialize_unit(self) -> Result<Scm<'gm>, Error> {
+        Ok(self.null())
+    }
+    fn serialize_unit_struct(self, _: &'static str) -> Result<Scm<'gm>, Error> {
+        Ok(self.null())
+    }
+    fn serialize_newtype_struct<T>(self, _: &'static str, value: &T) -> Result<Scm<'gm>, Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        value.serialize(self)
+    }
+
+    fn serialize_unit_variant(
+        self,
+        _: &'static str,
+        _: u32,
+        variant: &'static str,
+    ) -> Result<Scm<'gm>, Error> {
+        Ok(self.scm(self.symbol(variant)))
+    }
+    fn serialize_newtype_variant<T>(
+        self,
+        _: &'static str,
+        _: u32,
+        variant: &'static str,
+        value: &T,
+    ) -> Result<Scm<'gm>, Error>
+    where
+        T: Serialize + ?Sized,
+    {
+        let mut list = self.serialize_tuple_variant("", 0, variant, 1)?;
+        list.push(value)?;
+        Ok(list.finish())
+    }
+    fn serialize_tuple_variant(
+        self,
+        _: &'static str,
+        _: u32,
+        variant: &'static str,
+        _: usize,
+    ) -> Result<SerializeList<'gm>, Error> {
+        let mut list = ListBuilder::new();
+        list.push(self.symbol(variant));
+        Ok(SerializeList {
+            serializer: self,
+            list,
+        })
+    }
+    fn serialize_struct_variant(
+        self,
+        name: &'static str,
+        idx: u32,
+        variant: &'static str,
+        len: usize,
+    ) -> Result<SerializeList<'gm>, Error> {
+        self.serialize_tuple_variant(name, idx, variant, len)
+    }
+
+    fn serialize_seq(self, _: Option<usize>) -> Result<SerializeList<'gm>, Error> {
+        Ok(SerializeList {
+            serializer: self,
+            list: ListBuilder::new(),
+        })
+    }
+    fn serialize_tuple(self, len: usize) -> Result<SerializeVector<'gm>, Error> {
+        Ok(SerializeVector {
+            serializer: self,
+            vector: unsafe { scm_c_make_vector(len, SCM_BOOL_F) },
+            idx: 0,
+        })
+    }
+    fn serialize_tuple_struct(
+        self,
+        _: &'static str,
+        len: usize,
+    ) -> Result<SerializeVector<'gm>, Error> {
+        self.serialize_tuple(len)
+    }
+    fn serialize_map(self, len: Option<usize>) -> Result<SerializeHashMap<'gm>, Error> {
+        Ok(SerializeHashMap {
+            serializer: self,
+            map: HashMap::with_capacity(len.unwrap_or_default(), self.guile),
+            key: None,
+        })
+    }
+    fn serialize_struct(self, _: &'static str, _: usize) -> Result<SerializeList<'gm>, Error> {
+        self.serialize_seq(None)
+    }
+}
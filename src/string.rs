@@ -24,14 +24,20 @@ use {
         scm::{Scm, ToScm, TryFromScm},
         symbol::Symbol,
         sys::{
-            scm_c_string_length, scm_char_set_to_string, scm_from_utf8_stringn, scm_is_string,
-            scm_string, scm_string_equal_p, scm_string_null_p, scm_symbol_to_string,
-            scm_to_utf8_stringn,
+            SCM, scm_c_string_length, scm_car, scm_cdr, scm_char_set_to_string, scm_cons,
+            scm_from_uintptr_t, scm_from_utf8_stringn, scm_is_pair, scm_is_string,
+            scm_is_unsigned_integer, scm_string, scm_string_equal_p, scm_string_null_p,
+            scm_symbol_to_string, scm_to_uintptr_t, scm_to_utf8_stringn,
         },
         utils::{c_predicate, scm_predicate},
     },
     allocator_api2::vec::Vec,
-    std::{borrow::Cow, ffi::CStr, marker::PhantomData},
+    std::{
+        borrow::Cow,
+        ffi::CStr,
+        hash::{DefaultHasher, Hash, Hasher},
+        marker::PhantomData,
+    },
     string::String as BufString,
 };
 
@@ -168,6 +174,112 @@ impl<'gm> TryFromScm<'gm> for String<'gm> {
     }
 }
 
+/// Guile string with a hash that is computed once on creation.
+///
+/// This is stored in scheme as a `(hash . string)` pair so that [StringHashMap][crate::collections::hash_map::StringHashMap] can look it up without rehashing the contents.
+#[derive(Clone, Copy, Debug)]
+#[repr(transparent)]
+pub struct HashedString<'gm> {
+    ptr: SCM,
+    _marker: PhantomData<&'gm ()>,
+}
+impl<'gm> HashedString<'gm> {
+    /// Hash a utf8 string and copy it into guile.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{string::HashedString, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     assert_eq!(
+    ///         HashedString::from_str("foo", guile).hash(),
+    ///         HashedString::from_str("foo", guile).hash(),
+    ///     );
+    /// }).unwrap();
+    /// ```
+    pub fn from_str(string: &str, guile: &'gm Guile) -> Self {
+        Self::with_hash(hash_str(string), String::from_str(string, guile), guile)
+    }
+
+    fn with_hash(hash: usize, string: String<'gm>, _: &'gm Guile) -> Self {
+        Self {
+            ptr: unsafe { scm_cons(scm_from_uintptr_t(hash), string.as_ptr()) },
+            _marker: PhantomData,
+        }
+    }
+
+    /// Get the cached hash.
+    pub fn hash(&self) -> usize {
+        unsafe { scm_to_uintptr_t(scm_car(self.ptr)) }
+    }
+
+    /// Get the underlying string.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{string::{HashedString, String}, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     assert_eq!(HashedString::from_str("foo", guile).as_str(), String::from_str("foo", guile));
+    /// }).unwrap();
+    /// ```
+    pub fn as_str(&self) -> String<'gm> {
+        String {
+            scm: unsafe { Scm::from_ptr_unchecked(scm_cdr(self.ptr)) },
+            _marker: PhantomData,
+        }
+    }
+}
+impl<'gm> From<String<'gm>> for HashedString<'gm> {
+    /// Hash a guile string.
+    ///
+    /// This has to copy the string out of guile once to hash it.
+    fn from(string: String<'gm>) -> Self {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        Self::with_hash(hash_str(&string.as_string()), string, guile)
+    }
+}
+impl PartialEq for HashedString<'_> {
+    fn eq(&self, r: &Self) -> bool {
+        self.ptr == r.ptr || (self.hash() == r.hash() && self.as_str() == r.as_str())
+    }
+}
+unsafe impl ReprScm for HashedString<'_> {}
+impl<'gm> ToScm<'gm> for HashedString<'gm> {
+    fn to_scm(self, guile: &'gm Guile) -> Scm<'gm> {
+        Scm::from_ptr(self.ptr, guile)
+    }
+}
+impl<'gm> TryFromScm<'gm> for HashedString<'gm> {
+    fn type_name() -> Cow<'static, CStr> {
+        Cow::Borrowed(c"(usize . string)")
+    }
+
+    fn predicate(scm: &Scm<'gm>, _: &'gm Guile) -> bool {
+        let pair = scm.as_ptr();
+        c_predicate(unsafe { scm_is_pair(pair) })
+            && c_predicate(unsafe { scm_is_unsigned_integer(scm_car(pair), 0, usize::MAX) })
+            && c_predicate(unsafe { scm_is_string(scm_cdr(pair)) })
+    }
+
+    unsafe fn from_scm_unchecked(scm: Scm<'gm>, _: &'gm Guile) -> Self {
+        Self {
+            ptr: scm.as_ptr(),
+            _marker: PhantomData,
+        }
+    }
+}
+
+/// Hash a string into something that fits inside of a fixnum.
+fn hash_str(string: &str) -> usize {
+    let mut hasher = DefaultHasher::new();
+    string.hash(&mut hasher);
+    // shift off the bits used for fixnum tags so it never becomes a bignum
+    (hasher.finish() as usize) >> 3
+}
+
 #[cfg(test)]
 mod tests {
     use {super::*, crate::with_guile, std::ops::Deref};
@@ -227,4 +339,22 @@ mod tests {
         })
         .unwrap();
     }
+
+    #[cfg_attr(miri, ignore)]
+    #[test]
+    fn hashed_string() {
+        with_guile(|guile| {
+            let from_str = HashedString::from_str("hello", guile);
+            let from_string = HashedString::from(String::from_str("hello", guile));
+            assert_eq!(from_str.hash(), from_string.hash());
+            assert_eq!(from_str, from_string);
+            assert_ne!(from_str, HashedString::from_str("world", guile));
+            assert!(HashedString::predicate(&from_str.to_scm(guile), guile));
+            assert!(!HashedString::predicate(
+                &String::from_str("hello", guile).to_scm(guile),
+                guile
+            ));
+        })
+        .unwrap();
+    }
 }
@@ -18,14 +18,293 @@
 use {
     crate::{
         Guile,
+        alloc::GcAllocator,
+        collections::{list::List, vector::Vector},
+        eval::public_proc,
+        foreign_object::{self, ForeignObject},
+        module::Module,
         reference::ReprScm,
         scm::{Scm, ToScm, TryFromScm},
-        sys::{scm_call_n, scm_procedure_p},
+        string::String,
+        symbol::Symbol,
+        sys::{
+            SCM, scm_c_make_gsubr, scm_c_values, scm_call_n, scm_foreign_object_ref,
+            scm_gc_protect_object, scm_make_foreign_object_type, scm_procedure_p,
+            scm_set_procedure_property_x, scm_symbol_to_keyword, scm_unused_struct,
+        },
         utils::scm_predicate,
     },
-    std::{borrow::Cow, ffi::CStr},
+    allocator_api2::boxed::Box,
+    std::{
+        borrow::Cow,
+        ffi::{CStr, c_int, c_void},
+        ptr, slice,
+        sync::{
+            LazyLock, OnceLock,
+            atomic::{self, AtomicPtr},
+        },
+    },
 };
 
+/// Create a gsubr that is never garbage collected.
+///
+/// `doc` is stored as the `documentation` procedure property and `pure` as the `pure` procedure property, which is only metadata for scheme code to inspect.
+///
+/// # Safety
+///
+/// You must be in guile mode and `driver` must be an `extern "C"` function that takes `required + optional + rest` [SCM]s and returns a [SCM].
+#[doc(hidden)]
+pub unsafe fn make_gsubr(
+    name: &CStr,
+    required: usize,
+    optional: usize,
+    rest: bool,
+    doc: Option<&str>,
+    pure: bool,
+    driver: *mut c_void,
+) -> SCM {
+    let guile = unsafe { Guile::new_unchecked_ref() };
+    let proc = unsafe {
+        scm_gc_protect_object(scm_c_make_gsubr(
+            name.as_ptr(),
+            c_int::try_from(required).unwrap(),
+            c_int::try_from(optional).unwrap(),
+            c_int::from(rest),
+            driver,
+        ))
+    };
+    if let Some(doc) = doc {
+        unsafe {
+            scm_set_procedure_property_x(
+                proc,
+                Symbol::from_str("documentation", guile).as_ptr(),
+                String::from_str(doc, guile).as_ptr(),
+            );
+        }
+    }
+    if pure {
+        unsafe {
+            scm_set_procedure_property_x(
+                proc,
+                Symbol::from_str("pure", guile).as_ptr(),
+                true.to_scm(guile).as_ptr(),
+            );
+        }
+    }
+    proc
+}
+
+/// Convert an argument of an `unsafe(trusted)` [guile_fn], which is only type checked in debug builds.
+///
+/// # Safety
+///
+/// You must be in guile mode and `scm` must satisfy [TryFromScm::predicate].
+#[doc(hidden)]
+pub unsafe fn from_scm_trusted<'gm, T>(
+    scm: Scm<'gm>,
+    proc: &CStr,
+    idx: usize,
+    guile: &'gm Guile,
+) -> T
+where
+    T: TryFromScm<'gm>,
+{
+    // a panic cannot unwind out of the driver, so debug builds throw like checked procedures do
+    if cfg!(debug_assertions) {
+        T::from_scm_or_throw(scm, proc, idx, guile)
+    } else {
+        unsafe { T::from_scm_unchecked(scm, guile) }
+    }
+}
+
+/// Rust closure wrapped by [Proc::from_closure] or [Proc::from_fn].
+#[derive(Clone, Copy, ToScm, TryFromScm)]
+struct Closure {
+    /// Address of the closure, which is allocated by the garbage collector so that anything it captures stays alive.
+    data: usize,
+    call: for<'gm> unsafe fn(usize, &'gm Guile, &[SCM]) -> Scm<'gm>,
+    drop: unsafe fn(usize),
+}
+impl ForeignObject for Closure {
+    unsafe fn get_or_create_type() -> SCM {
+        static OBJECT_TYPE: LazyLock<AtomicPtr<scm_unused_struct>> = LazyLock::new(|| {
+            let guile = unsafe { Guile::new_unchecked_ref() };
+            let name = Symbol::from_str("closure", guile);
+            unsafe {
+                scm_make_foreign_object_type(
+                    name.as_ptr(),
+                    foreign_object::slots(),
+                    Some(finalize_closure),
+                )
+            }
+            .into()
+        });
+
+        OBJECT_TYPE.load(atomic::Ordering::Acquire)
+    }
+}
+/// Drop the closure once its procedure is garbage collected.
+///
+/// # Safety
+///
+/// `obj` must be a [Closure].
+unsafe extern "C" fn finalize_closure(obj: SCM) {
+    let closure = unsafe {
+        scm_foreign_object_ref(obj, 0)
+            .cast::<Closure>()
+            .read_unaligned()
+    };
+    unsafe { (closure.drop)(closure.data) }
+}
+unsafe fn call_closure_data<'gm, F>(data: usize, guile: &'gm Guile, args: &[SCM]) -> Scm<'gm>
+where
+    F: for<'a> Fn(&'a Guile, &List<'a, Scm<'a>>) -> Scm<'a>,
+{
+    // SAFETY: the variadic wrapper passes its rest list as the only argument.
+    let args = unsafe { List::from_scm_unchecked(Scm::from_ptr(args[0], guile), guile) };
+    (unsafe { &*(data as *const F) })(guile, &args)
+}
+unsafe fn call_fn_data<'gm, F, A>(data: usize, guile: &'gm Guile, args: &[SCM]) -> Scm<'gm>
+where
+    F: ClosureFn<A>,
+{
+    unsafe { (*(data as *const F)).call_scm(args, guile) }
+}
+unsafe fn drop_closure_data<F>(data: usize) {
+    unsafe { ptr::drop_in_place(data as *mut F) }
+}
+/// Call the [Closure] `closure` with the rest of the arguments of a trampoline.
+///
+/// # Safety
+///
+/// You must be in guile mode and `args` must have the arity the closure was created with.
+unsafe fn call_closure(closure: SCM, args: &[SCM]) -> SCM {
+    let guile = unsafe { Guile::new_unchecked_ref() };
+    let closure = Closure::from_scm_or_throw(Scm::from_ptr(closure, guile), c"closure", 0, guile);
+    unsafe { (closure.call)(closure.data, guile, args) }.as_ptr()
+}
+
+/// Most arguments a closure can take, which is the limit of a gsubr minus the closure itself.
+const CLOSURE_ARITY_MAX: usize = 9;
+macro_rules! closure_trampolines {
+    ($($arity:literal => $name:ident($($arg:ident),*);)+) => {
+        $(
+            unsafe extern "C" fn $name(closure: SCM, $($arg: SCM),*) -> SCM {
+                unsafe { call_closure(closure, &[$($arg),*]) }
+            }
+        )+
+
+        /// Get the gsubr that calls a [Closure] with `arity` arguments.
+        fn closure_trampoline<'gm>(arity: usize, guile: &'gm Guile) -> Scm<'gm> {
+            static TRAMPOLINES: [OnceLock<usize>; CLOSURE_ARITY_MAX + 1] =
+                [const { OnceLock::new() }; CLOSURE_ARITY_MAX + 1];
+
+            let trampoline = *TRAMPOLINES[arity].get_or_init(|| {
+                let driver = match arity {
+                    $($arity => $name as *mut c_void,)+
+                    _ => unreachable!("closures take at most {CLOSURE_ARITY_MAX} arguments"),
+                };
+                (unsafe { make_gsubr(c"closure", arity + 1, 0, false, None, false, driver) }) as usize
+            });
+            Scm::from_ptr(trampoline as SCM, guile)
+        }
+    };
+}
+closure_trampolines! {
+    0 => trampoline_0();
+    1 => trampoline_1(a0);
+    2 => trampoline_2(a0, a1);
+    3 => trampoline_3(a0, a1, a2);
+    4 => trampoline_4(a0, a1, a2, a3);
+    5 => trampoline_5(a0, a1, a2, a3, a4);
+    6 => trampoline_6(a0, a1, a2, a3, a4, a5);
+    7 => trampoline_7(a0, a1, a2, a3, a4, a5, a6);
+    8 => trampoline_8(a0, a1, a2, a3, a4, a5, a6, a7);
+    9 => trampoline_9(a0, a1, a2, a3, a4, a5, a6, a7, a8);
+}
+/// Get the compiled procedure that wraps a trampoline and a [Closure] in a procedure taking `arity` arguments, or a rest list if `arity` is [None].
+fn closure_maker<'gm>(arity: Option<usize>, guile: &'gm Guile) -> Proc<'gm> {
+    static MAKERS: [OnceLock<usize>; CLOSURE_ARITY_MAX + 2] =
+        [const { OnceLock::new() }; CLOSURE_ARITY_MAX + 2];
+
+    let maker = *MAKERS[arity.unwrap_or(CLOSURE_ARITY_MAX + 1)].get_or_init(|| {
+        let source = match arity {
+            Some(arity) => {
+                let params = (0..arity)
+                    .map(|i| format!("a{i}"))
+                    .collect::<Vec<_>>()
+                    .join(" ");
+                format!("'(lambda (trampoline closure) (lambda ({params}) (trampoline closure {params})))")
+            }
+            None => "'(lambda (trampoline closure) (lambda args (trampoline closure args)))".into(),
+        };
+        let module = Module::resolve(&List::from_iter([Symbol::from_str("guile", guile)], guile))
+            .expect("`(guile)` should always exist");
+        let expr = unsafe { guile.eval_in::<Scm>(&String::from_str(&source, guile), &module) }
+            .expect("any object can be converted to a `Scm`");
+        let env = unsafe {
+            Scm::from_ptr(
+                scm_symbol_to_keyword(Symbol::from_str("env", guile).as_ptr()),
+                guile,
+            )
+        };
+        let proc = unsafe {
+            public_proc(c"system base compile", c"compile", guile)
+                .call::<3, _, Proc>((expr, env, module))
+        }
+        .expect("the closure maker should compile to a procedure");
+        (unsafe { scm_gc_protect_object(proc.as_ptr()) }) as usize
+    });
+    Proc(Scm::from_ptr(maker as SCM, guile))
+}
+
+/// Rust function with typed arguments that can be wrapped by [Proc::from_fn].
+///
+/// This is implemented for [Fn]s of up to 9 arguments that can be converted from [Scm]s and a return value that can be converted into one.
+pub trait ClosureFn<A>: Send + Sync + 'static {
+    /// Number of arguments.
+    const ARITY: usize;
+
+    /// Convert the arguments, throwing a wrong type error if one of them is invalid, and call the function.
+    ///
+    /// # Safety
+    ///
+    /// You must be in guile mode and `args` must have [Self::ARITY] elements.
+    unsafe fn call_scm<'gm>(&self, args: &[SCM], guile: &'gm Guile) -> Scm<'gm>;
+}
+macro_rules! impl_closure_fn_for {
+    ($($idx:literal $ty:ident $arg:ident),*) => {
+        impl<F, R, $($ty),*> ClosureFn<($($ty,)*)> for F
+        where
+            F: Fn($($ty),*) -> R + Send + Sync + 'static,
+            R: for<'gm> ToScm<'gm>,
+            $($ty: for<'gm> TryFromScm<'gm>),*
+        {
+            const ARITY: usize = <[&str]>::len(&[$(stringify!($ty)),*]);
+
+            unsafe fn call_scm<'gm>(&self, args: &[SCM], guile: &'gm Guile) -> Scm<'gm> {
+                let &[$($arg),*] = args else {
+                    unreachable!("the trampoline passes exactly `ARITY` arguments");
+                };
+                $(
+                    let $arg = $ty::from_scm_or_throw(Scm::from_ptr($arg, guile), c"closure", $idx, guile);
+                )*
+                self($($arg),*).to_scm(guile)
+            }
+        }
+    };
+}
+impl_closure_fn_for!();
+impl_closure_fn_for!(0 A0 a0);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1, 2 A2 a2);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1, 2 A2 a2, 3 A3 a3);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1, 2 A2 a2, 3 A3 a3, 4 A4 a4);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1, 2 A2 a2, 3 A3 a3, 4 A4 a4, 5 A5 a5);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1, 2 A2 a2, 3 A3 a3, 4 A4 a4, 5 A5 a5, 6 A6 a6);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1, 2 A2 a2, 3 A3 a3, 4 A4 a4, 5 A5 a5, 6 A6 a6, 7 A7 a7);
+impl_closure_fn_for!(0 A0 a0, 1 A1 a1, 2 A2 a2, 3 A3 a3, 4 A4 a4, 5 A5 a5, 6 A6 a6, 7 A7 a7, 8 A8 a8);
+
 pub(crate) trait TupleExt<'gm, const ARITY: usize> {
     fn to_slice(self, _: &'gm Guile) -> [Scm<'gm>; ARITY];
 }
@@ -36,6 +315,11 @@ macro_rules! impl_tuple_ext_for {
                 []
             }
         }
+        impl<'gm> $crate::scm::ToScm<'gm> for $crate::subr::Values<()> {
+            fn to_scm(self, guile: &'gm $crate::Guile) -> $crate::scm::Scm<'gm> {
+                $crate::scm::ToScm::to_scm($crate::subr::Values($crate::subr::TupleExt::to_slice(self.0, guile)), guile)
+            }
+        }
     };
     ($car:ident $(, $($cdr:ident),+)?) => {
         impl<'gm, $car $(, $($cdr),+)?> $crate::subr::TupleExt<'gm, {
@@ -63,16 +347,114 @@ macro_rules! impl_tuple_ext_for {
                 ]
             }
         }
+        impl<'gm, $car $(, $($cdr),+)?> $crate::scm::ToScm<'gm> for $crate::subr::Values<($car, $($($cdr),+)?)>
+        where
+            $car: $crate::scm::ToScm<'gm>,
+            $($($cdr: $crate::scm::ToScm<'gm>),+)?
+        {
+            fn to_scm(self, guile: &'gm $crate::Guile) -> $crate::scm::Scm<'gm> {
+                $crate::scm::ToScm::to_scm($crate::subr::Values($crate::subr::TupleExt::to_slice(self.0, guile)), guile)
+            }
+        }
 
         impl_tuple_ext_for!($($($cdr),+)?);
     };
 }
 impl_tuple_ext_for!(A, B, C, D, E, F, G, H, I, J, K, L);
 
+/// Multiple values returned from a [guile_fn] without allocating a list.
+///
+/// This is implemented for tuples and arrays.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{module::Module, string::String, subr::{GuileFn, Values, guile_fn}, symbol::Symbol, with_guile};
+/// #[guile_fn]
+/// fn div_rem(l: &i32, r: &i32) -> Values<(i32, i32)> {
+///     Values((*l / *r, *l % *r))
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     Module::current(guile).define(Symbol::from_str("div-rem", guile), DivRem::create(guile));
+///     assert_eq!(
+///         unsafe { guile.eval::<i32>(&String::from_str("(call-with-values (lambda () (div-rem 7 2)) -)", guile)) },
+///         Ok(2),
+///     );
+/// }).unwrap();
+/// ```
+pub struct Values<T>(pub T);
+impl<'gm, const N: usize, T> ToScm<'gm> for Values<[T; N]>
+where
+    T: ToScm<'gm>,
+{
+    fn to_scm(self, guile: &'gm Guile) -> Scm<'gm> {
+        let mut values = self.0.map(|value| value.to_scm(guile).as_ptr());
+        Scm::from_ptr(unsafe { scm_c_values(values.as_mut_ptr(), N) }, guile)
+    }
+}
+
+/// Iterator returned from a [guile_fn] that is collected into a list as it is consumed.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{collections::list::List, reference::Ref, subr::{GuileFn, ToList, guile_fn}, with_guile};
+/// #[guile_fn]
+/// fn iota(n: &usize) -> ToList<std::ops::Range<usize>> {
+///     ToList(0..*n)
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let lst = unsafe { Iota::create(guile).call::<1, _, List<usize>>((3usize,)) }.unwrap();
+///     assert_eq!(lst.iter().map(Ref::copied).collect::<Vec<_>>(), [0, 1, 2]);
+/// }).unwrap();
+/// ```
+pub struct ToList<I>(pub I);
+impl<'gm, I> ToScm<'gm> for ToList<I>
+where
+    I: IntoIterator,
+    I::Item: ToScm<'gm>,
+{
+    fn to_scm(self, guile: &'gm Guile) -> Scm<'gm> {
+        List::from_iter_in_order(self.0, guile).to_scm(guile)
+    }
+}
+
+/// Iterator of known length returned from a [guile_fn] that is written into a vector as it is consumed.
+///
+/// # Examples
+///
+/// ```
+/// # use garguile::{collections::vector::Vector, subr::{GuileFn, ToVector, guile_fn}, with_guile};
+/// #[guile_fn]
+/// fn squares(n: &usize) -> ToVector<Vec<usize>> {
+///     ToVector((0..*n).map(|i| i * i).collect())
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let vec = unsafe { Squares::create(guile).call::<1, _, Vector<usize>>((3usize,)) }.unwrap();
+///     assert_eq!(vec.into_iter().collect::<Vec<_>>(), [0, 1, 4]);
+/// }).unwrap();
+/// ```
+pub struct ToVector<I>(pub I);
+impl<'gm, I> ToScm<'gm> for ToVector<I>
+where
+    I: IntoIterator,
+    I::IntoIter: ExactSizeIterator,
+    I::Item: ToScm<'gm>,
+{
+    fn to_scm(self, guile: &'gm Guile) -> Scm<'gm> {
+        Vector::from_exact_iter(self.0, guile).to_scm(guile)
+    }
+}
+
 /// Scheme functions.
 #[repr(transparent)]
 pub struct Proc<'gm>(Scm<'gm>);
 impl<'gm> Proc<'gm> {
+    /// Call the procedure with a tuple of arguments.
+    ///
     /// # Safety
     ///
     /// Ensure the function doesn't do anything unsafe like dereferencing null pointers or something since theses can do anything that guile can.
@@ -98,11 +480,170 @@ impl<'gm> Proc<'gm> {
     {
         // SAFETY: we are in guile mode since `Proc` has the `'gm` lifetime.
         let guile = unsafe { Guile::new_unchecked_ref() };
-        let mut slice = args.to_slice(guile).map(|scm| scm.as_ptr());
+        unsafe { self.call_array(args.to_slice(guile)) }
+    }
+    /// Call the procedure with an array of arguments of the same type, which has no limit on its length.
+    ///
+    /// # Safety
+    ///
+    /// See [Proc::call].
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{string::String, subr::Proc, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut add = unsafe { guile.eval::<Proc>(&String::from_str("+", guile)) }.unwrap();
+    ///     assert_eq!(unsafe { add.call_array::<24, _, i32>(std::array::from_fn(|i| i as i32)) }, Ok(276));
+    /// }).unwrap();
+    /// ```
+    pub unsafe fn call_array<const N: usize, A, T>(&mut self, args: [A; N]) -> Result<T, Scm<'gm>>
+    where
+        A: ToScm<'gm>,
+        T: TryFromScm<'gm>,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        let mut args = args.map(|arg| arg.to_scm(guile).as_ptr());
 
-        let output = unsafe { scm_call_n(self.0.as_ptr(), slice.as_mut_ptr(), slice.len()) };
+        let output = unsafe { scm_call_n(self.0.as_ptr(), args.as_mut_ptr(), N) };
         T::try_from_scm(Scm::from_ptr(output, guile), guile)
     }
+    /// Call the procedure with arguments whose number is only known at runtime.
+    ///
+    /// # Safety
+    ///
+    /// See [Proc::call].
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{collections::list::List, scm::{Scm, ToScm}, string::String, subr::Proc, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let mut list = unsafe { guile.eval::<Proc>(&String::from_str("list", guile)) }.unwrap();
+    ///     let args = (0..30).map(|i| i.to_scm(guile)).collect::<Vec<Scm>>();
+    ///     assert_eq!(unsafe { list.call_slice::<List<i32>>(&args) }.map(|lst| lst.iter().count()), Ok(30));
+    ///     assert_eq!(unsafe { list.call_slice::<List<i32>>(&[]) }.map(|lst| lst.is_empty()), Ok(true));
+    /// }).unwrap();
+    /// ```
+    pub unsafe fn call_slice<T>(&mut self, args: &[Scm<'gm>]) -> Result<T, Scm<'gm>>
+    where
+        T: TryFromScm<'gm>,
+    {
+        let guile = unsafe { Guile::new_unchecked_ref() };
+        // SAFETY: `Scm` is a transparent wrapper of `SCM`.
+        let args = unsafe { slice::from_raw_parts(args.as_ptr().cast::<SCM>(), args.len()) };
+        // SAFETY: `scm_call_n` only reads the arguments.
+        let output = unsafe { scm_call_n(self.0.as_ptr(), args.as_ptr().cast_mut(), args.len()) };
+        T::try_from_scm(Scm::from_ptr(output, guile), guile)
+    }
+    /// Check whether this is the procedure made by a [guile_fn].
+    ///
+    /// If it is, the `call` function generated next to the [GuileFn] calls the rust function directly, without going through the VM or checking the arguments.
+    /// [guile_fn] creates its procedure once and caches it in a static, so this is an atomic load and a pointer comparison.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{module::Module, string::String, subr::{GuileFn, Proc, guile_fn}, symbol::Symbol, with_guile};
+    /// #[guile_fn]
+    /// fn mul(l: &i32, r: &i32) -> i32 {
+    ///     *l * *r
+    /// }
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     Module::current(guile).define(Symbol::from_str("mul", guile), Mul::create(guile));
+    ///     let mut proc = unsafe { guile.eval::<Proc>(&String::from_str("mul", guile)) }.unwrap();
+    ///     assert!(proc.is::<Mul>(guile));
+    ///     let product = if proc.is::<Mul>(guile) {
+    ///         Mul::call(&4, &2)
+    ///     } else {
+    ///         unsafe { proc.call((4, 2)) }.unwrap()
+    ///     };
+    ///     assert_eq!(product, 8);
+    /// }).unwrap();
+    /// ```
+    pub fn is<F>(&self, guile: &'gm Guile) -> bool
+    where
+        F: GuileFn,
+    {
+        F::create(guile).as_ptr() == self.as_ptr()
+    }
+    /// Wrap a closure in a procedure that takes any number of arguments, which are passed as a list.
+    ///
+    /// The closure is dropped once the procedure is garbage collected.
+    /// Use [Self::from_fn] if the number of arguments is fixed, which avoids allocating the list on every call.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{scm::ToScm, subr::Proc, with_guile};
+    /// # use std::sync::{Arc, atomic::{AtomicUsize, Ordering}};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let calls = Arc::new(AtomicUsize::new(0));
+    ///     let counter = Arc::clone(&calls);
+    ///     let mut proc = Proc::from_closure(move |guile, args| {
+    ///         counter.fetch_add(1, Ordering::Relaxed);
+    ///         args.iter().count().to_scm(guile)
+    ///     }, guile);
+    ///     assert_eq!(unsafe { proc.call::<3, _, usize>((1, 2, 3)) }, Ok(3));
+    ///     assert_eq!(unsafe { proc.call::<0, _, usize>(()) }, Ok(0));
+    ///     assert_eq!(calls.load(Ordering::Relaxed), 2);
+    /// }).unwrap();
+    /// ```
+    pub fn from_closure<F>(f: F, guile: &'gm Guile) -> Self
+    where
+        F: for<'a> Fn(&'a Guile, &List<'a, Scm<'a>>) -> Scm<'a> + Send + Sync + 'static,
+    {
+        Self::wrap_closure(f, None, call_closure_data::<F>, guile)
+    }
+    /// Wrap a closure with typed arguments in a procedure that takes exactly that many arguments.
+    ///
+    /// Arguments of the wrong type throw a `wrong-type-arg` error. The closure is dropped once the procedure is garbage collected.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use garguile::{module::Module, string::String, subr::Proc, symbol::Symbol, with_guile};
+    /// # #[cfg(not(miri))]
+    /// with_guile(|guile| {
+    ///     let offset = 10;
+    ///     let proc = Proc::from_fn(move |l: i32, r: i32| l * r + offset, guile);
+    ///     Module::current(guile).define(Symbol::from_str("mul-offset", guile), proc);
+    ///     assert_eq!(unsafe { guile.eval::<i32>(&String::from_str("(mul-offset 4 2)", guile)) }, Ok(18));
+    ///     assert!(unsafe { guile.eval::<i32>(&String::from_str("(mul-offset 4 \"2\")", guile)) }.is_err());
+    ///     assert!(unsafe { guile.eval::<i32>(&String::from_str("(mul-offset 4)", guile)) }.is_err());
+    /// }).unwrap();
+    /// ```
+    pub fn from_fn<F, A>(f: F, guile: &'gm Guile) -> Self
+    where
+        F: ClosureFn<A>,
+    {
+        Self::wrap_closure(f, Some(F::ARITY), call_fn_data::<F, A>, guile)
+    }
+    fn wrap_closure<F>(
+        f: F,
+        arity: Option<usize>,
+        call: for<'a> unsafe fn(usize, &'a Guile, &[SCM]) -> Scm<'a>,
+        guile: &'gm Guile,
+    ) -> Self
+    where
+        F: Send + Sync + 'static,
+    {
+        let data = Box::into_raw(Box::new_in(f, GcAllocator::new(c"closure", guile)));
+        let closure = Closure {
+            data: data as usize,
+            call,
+            drop: drop_closure_data::<F>,
+        };
+        // the variadic wrapper passes its rest list as a single argument
+        let trampoline = closure_trampoline(arity.unwrap_or(1), guile);
+
+        unsafe { closure_maker(arity, guile).call((trampoline, closure)) }
+            .expect("the closure maker should return a procedure")
+    }
 }
 unsafe impl ReprScm for Proc<'_> {}
 impl<'gm> TryFromScm<'gm> for Proc<'gm> {
@@ -130,7 +671,13 @@ pub trait GuileFn {
     fn create<'gm>(_: &'gm Guile) -> Proc<'gm>;
 }
 
-/// Create a struct and implement [GuileFn] for it.
+/// [GuileFn] with the name it is defined under, which [guile_fn] implements from `guile_ident`.
+pub trait NamedGuileFn: GuileFn {
+    /// Name of the procedure.
+    const NAME: &'static CStr;
+}
+
+/// Create a struct and implement [GuileFn] and [NamedGuileFn] for it.
 ///
 /// The function requires everything to be behind references.
 ///
@@ -143,6 +690,14 @@ pub trait GuileFn {
 /// | `guile_ident` | Identifier of the function used in metadata. Defaults to the name of the function but in kebab case | [c string literal][CStr] |
 /// | `struct_ident` | The identifier used to implement [GuileFn]. Defaults to the name of the function but in pascal case | identfier |
 /// | `garguile_root` | The path to the `garguile` crate. This is useful if you renamed the crate. | path |
+/// | `pure` | Set the `pure` procedure property to record that the procedure is free of side effects. This is informational only: guile's optimizer doesn't read it, so calls are never constant folded or hoisted. | flag |
+/// | `unsafe(trusted)` | Skip type checking the arguments in release builds. See [Safety](#safety). | flag |
+///
+/// # Safety
+///
+/// `unsafe(trusted)` procedures convert their arguments with [TryFromScm::from_scm_unchecked] in release builds.
+/// Calling one with an argument that doesn't satisfy [TryFromScm::predicate] is undefined behavior, so never expose one where arbitrary scheme code can call it.
+/// Debug builds still check the arguments and throw `wrong-type-arg` to catch mistakes early, which release builds must not rely on.
 ///
 /// # Examples
 ///
@@ -161,6 +716,21 @@ pub trait GuileFn {
 /// ```
 ///
 /// ```
+/// # use garguile::{module::Module, string::String, subr::{guile_fn, GuileFn}, with_guile};
+/// #[guile_fn(pure)]
+/// /// Square a number.
+/// fn square(i: &i32) -> i32 {
+///     *i * *i
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     Module::current(guile).define_fn::<Square>(guile).unwrap();
+///     assert_eq!(unsafe { guile.eval::<bool>(&String::from_str("(procedure-property square 'pure)", guile)) }, Ok(true));
+///     assert_eq!(unsafe { guile.eval::<bool>(&String::from_str("(string? (procedure-documentation square))", guile)) }, Ok(true));
+/// }).unwrap();
+/// ```
+///
+/// ```
 /// # use garguile::{subr::guile_fn, subr::GuileFn};
 /// #[guile_fn(guile_ident = c"is-even?", struct_ident = EvenPredicate)]
 /// fn is_even(i: &i32) -> bool {
@@ -169,6 +739,27 @@ pub trait GuileFn {
 /// ```
 ///
 /// ```
+/// # use garguile::{collections::list::List, subr::{GuileFn, guile_fn}, with_guile};
+/// #[guile_fn(unsafe(trusted))]
+/// fn list_length(lst: &List<i32>) -> usize {
+///     lst.iter().count()
+/// }
+/// # #[cfg(not(miri))]
+/// with_guile(|guile| {
+///     let lst = List::from_iter([1, 2, 3], guile);
+///     assert_eq!(unsafe { ListLength::create(guile).call((lst,)) }, Ok(3usize));
+/// }).unwrap();
+/// ```
+///
+/// ```compile_fail
+/// # use garguile::{collections::list::List, subr::guile_fn};
+/// #[guile_fn(trusted)]
+/// fn list_length(lst: &List<i32>) -> usize {
+///     lst.iter().count()
+/// }
+/// ```
+///
+/// ```
 /// # use garguile::{collections::list::List, module::Module, reference::Ref, string::String, subr::{GuileFn, guile_fn}, symbol::Symbol, with_guile};
 /// #[guile_fn]
 /// fn sum(init: &i32, #[rest] r: &List<i32>) -> i32 {
@@ -17,7 +17,7 @@
 #![expect(missing_docs)]
 
 use std::{
-    ffi::{c_char, c_double, c_int, c_void},
+    ffi::{c_char, c_double, c_int, c_ulong, c_void},
     ptr,
 };
 
@@ -34,6 +34,8 @@ pub type scm_t_wind_flags = c_int;
 pub type scm_t_thunk = Option<unsafe extern "C" fn(*mut c_void) -> SCM>;
 pub type scm_t_catch_body = scm_t_thunk;
 pub type scm_t_catch_handler = Option<unsafe extern "C" fn(*mut c_void, SCM, SCM) -> SCM>;
+pub type scm_t_hash_fold_fn =
+    Option<unsafe extern "C" fn(_closure: *mut c_void, _key: SCM, _val: SCM, _result: SCM) -> SCM>;
 
 #[derive(Default)]
 #[repr(C)]
@@ -122,6 +124,10 @@ unsafe extern "C" {
     pub fn GARGUILE_REEXPORTS_SCM_IS_A_P(_val: SCM, _ty: SCM) -> c_int;
     pub fn GARGUILE_REEXPORTS_SCM_UNBNDP(_: SCM) -> c_int;
 
+    pub fn GARGUILE_REEXPORTS_SCM_HASHTABLE_P(_obj: SCM) -> c_int;
+    pub fn GARGUILE_REEXPORTS_SCM_HASHTABLE_VECTOR(_table: SCM) -> SCM;
+    pub fn GARGUILE_REEXPORTS_SCM_HASHTABLE_N_ITEMS(_table: SCM) -> c_ulong;
+
     pub fn scm_with_guile(
         _func: Option<unsafe extern "C" fn(*mut c_void) -> *mut c_void>,
         _data: *mut c_void,
@@ -158,12 +164,21 @@ unsafe extern "C" {
     pub fn scm_current_module() -> SCM;
     pub fn scm_maybe_resolve_module(_name: SCM) -> SCM;
     pub fn scm_module_export(_module: SCM, _symbol_list: SCM) -> SCM;
+    pub fn scm_c_define_module(
+        _name: *const c_char,
+        _init: Option<unsafe extern "C" fn(_: *mut c_void)>,
+        _data: *mut c_void,
+    ) -> SCM;
     pub fn scm_module_public_interface(_module: SCM) -> SCM;
 
     pub fn scm_public_ref(_module_name: SCM, _name: SCM) -> SCM;
+    pub fn scm_c_public_ref(_module_name: *const c_char, _name: *const c_char) -> SCM;
     pub fn scm_variable_ref(_var: SCM) -> SCM;
 
+    pub fn scm_eof_object_p(_x: SCM) -> SCM;
+
     pub fn scm_from_utf8_stringn(_: *const c_char, _: usize) -> SCM;
+    pub fn scm_from_locale_stringn(_: *const c_char, _: usize) -> SCM;
     pub fn scm_to_utf8_stringn(_: SCM, _: *mut usize) -> *mut c_char;
     pub fn scm_string_equal_p(_s1: SCM, _s2: SCM) -> SCM;
     pub fn scm_string_null_p(_str: SCM) -> SCM;
@@ -207,7 +222,16 @@ unsafe extern "C" {
     pub fn scm_symbol_interned_p(_symbol: SCM) -> SCM;
 
     pub fn scm_make_hash_table(_n: SCM) -> SCM;
+    pub fn scm_make_weak_key_hash_table(_n: SCM) -> SCM;
+    pub fn scm_make_weak_value_hash_table(_n: SCM) -> SCM;
+    pub fn scm_make_doubly_weak_hash_table(_n: SCM) -> SCM;
     pub fn scm_hash_table_p(_obj: SCM) -> SCM;
+    pub fn scm_weak_key_hash_table_p(_obj: SCM) -> SCM;
+    pub fn scm_weak_value_hash_table_p(_obj: SCM) -> SCM;
+    pub fn scm_doubly_weak_hash_table_p(_obj: SCM) -> SCM;
+    pub fn scm_hash_ref(_table: SCM, _key: SCM, _dflt: SCM) -> SCM;
+    pub fn scm_hashq_ref(_table: SCM, _key: SCM, _dflt: SCM) -> SCM;
+    pub fn scm_hashv_ref(_table: SCM, _key: SCM, _dflt: SCM) -> SCM;
     pub fn scm_hash_set_x(_table: SCM, _key: SCM, _val: SCM) -> SCM;
     pub fn scm_hashq_set_x(_table: SCM, _key: SCM, _val: SCM) -> SCM;
     pub fn scm_hashv_set_x(_table: SCM, _key: SCM, _val: SCM) -> SCM;
@@ -221,6 +245,24 @@ unsafe extern "C" {
     pub fn scm_hashq_create_handle_x(_table: SCM, _key: SCM, _init: SCM) -> SCM;
     pub fn scm_hashv_create_handle_x(_table: SCM, _key: SCM, _init: SCM) -> SCM;
     pub fn scm_hash_fold(_proc: SCM, _init: SCM, _table: SCM) -> SCM;
+    pub fn scm_internal_hash_fold(
+        _fn: scm_t_hash_fold_fn,
+        _closure: *mut c_void,
+        _init: SCM,
+        _table: SCM,
+    ) -> SCM;
+    pub fn scm_hash_clear_x(_table: SCM) -> SCM;
+    pub fn scm_hashx_set_x(_hash: SCM, _assoc: SCM, _table: SCM, _key: SCM, _val: SCM) -> SCM;
+    pub fn scm_hashx_remove_x(_hash: SCM, _assoc: SCM, _table: SCM, _key: SCM) -> SCM;
+    pub fn scm_hashx_ref(_hash: SCM, _assoc: SCM, _table: SCM, _key: SCM, _dflt: SCM) -> SCM;
+    pub fn scm_hashx_get_handle(_hash: SCM, _assoc: SCM, _table: SCM, _key: SCM) -> SCM;
+    pub fn scm_hashx_create_handle_x(
+        _hash: SCM,
+        _assoc: SCM,
+        _table: SCM,
+        _key: SCM,
+        _init: SCM,
+    ) -> SCM;
 
     pub fn scm_from_double(_: c_double) -> SCM;
     pub fn scm_from_int8(_: i8) -> SCM;
@@ -431,7 +473,11 @@ unsafe extern "C" {
     // pub fn scm_take_c64vector(_data: *const f64, _len: usize) -> SCM;
 
     pub fn scm_vector_p(_obj: SCM) -> SCM;
+    pub fn scm_is_vector(_obj: SCM) -> c_int;
+    pub fn scm_c_vector_length(_vec: SCM) -> usize;
+    pub fn scm_c_vector_ref(_vec: SCM, _k: usize) -> SCM;
     pub fn scm_c_make_vector(_k: usize, _fill: SCM) -> SCM;
+    pub fn scm_c_vector_set_x(_vec: SCM, _k: usize, _obj: SCM);
     pub fn scm_vector(_l: SCM) -> SCM;
     pub fn scm_vector_to_list(_v: SCM) -> SCM;
 
@@ -503,6 +549,7 @@ unsafe extern "C" {
 
     pub fn scm_gc_protect_object(_: SCM) -> SCM;
     pub fn scm_gc_unprotect_object(_: SCM) -> SCM;
+    pub fn scm_remember_upto_here_1(_obj: SCM);
 
     pub fn scm_eq_p(_: SCM, _: SCM) -> SCM;
     pub fn scm_eqv_p(_: SCM, _: SCM) -> SCM;
@@ -530,6 +577,11 @@ unsafe extern "C" {
     pub fn scm_procedure_p(_obj: SCM) -> SCM;
     pub fn scm_set_procedure_property_x(_proc: SCM, _key: SCM, _val: SCM) -> SCM;
     pub fn scm_call_n(_proc: SCM, _argv: *mut SCM, _nargs: usize) -> SCM;
+    pub fn scm_c_values(_base: *mut SCM, _n: usize) -> SCM;
+
+    pub fn scm_struct_p(_x: SCM) -> SCM;
+    pub fn scm_struct_vtable(_handle: SCM) -> SCM;
+    pub fn scm_struct_ref(_handle: SCM, _pos: SCM) -> SCM;
 
     pub fn scm_eval_string(_string: SCM) -> SCM;
     pub fn scm_eval_string_in_module(_string: SCM, _module: SCM) -> SCM;
@@ -566,6 +618,9 @@ pub use GARGUILE_REEXPORTS_SCM_BOOL_T as SCM_BOOL_T;
 pub use GARGUILE_REEXPORTS_SCM_EOL as SCM_EOL;
 pub use GARGUILE_REEXPORTS_SCM_F_DYNWIND_REWINDABLE as SCM_F_DYNWIND_REWINDABLE;
 pub use GARGUILE_REEXPORTS_SCM_F_WIND_EXPLICITLY as SCM_F_WIND_EXPLICITLY;
+pub use GARGUILE_REEXPORTS_SCM_HASHTABLE_N_ITEMS as SCM_HASHTABLE_N_ITEMS;
+pub use GARGUILE_REEXPORTS_SCM_HASHTABLE_P as SCM_HASHTABLE_P;
+pub use GARGUILE_REEXPORTS_SCM_HASHTABLE_VECTOR as SCM_HASHTABLE_VECTOR;
 pub use GARGUILE_REEXPORTS_SCM_HOOK_ARITY as SCM_HOOK_ARITY;
 pub use GARGUILE_REEXPORTS_SCM_HOOKP as SCM_HOOKP;
 pub use GARGUILE_REEXPORTS_SCM_IS_A_P as SCM_IS_A_P;
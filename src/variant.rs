@@ -0,0 +1,88 @@
+// garguile - guile bindings for rust
+// Copyright (C) 2025  Andrew Chi
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//! Rust enums represented as symbols and tagged lists.
+//!
+//! Deriving [ToScm][crate::scm::ToScm] and [TryFromScm][crate::scm::TryFromScm] with `#[scm_repr = "enum"]` converts unit variants into symbols and variants with fields into lists headed by a symbol, followed by the fields in the order they are declared.
+//! Symbols are named after the variant in kebab case and interned once, so checking the variant is a pointer comparison.
+//!
+//! # Examples
+//!
+//! ```
+//! # use garguile::{scm::{ToScm, TryFromScm}, string::String, with_guile};
+//! #[derive(Clone, Copy, Debug, PartialEq, ToScm, TryFromScm)]
+//! #[scm_repr = "enum"]
+//! enum Op {
+//!     Nop,
+//!     LoadConst(i32),
+//!     Jump { offset: i32, relative: bool },
+//! }
+//! # #[cfg(not(miri))]
+//! with_guile(|guile| {
+//!     assert_eq!(unsafe { guile.eval::<Op>(&String::from_str("'nop", guile)) }, Ok(Op::Nop));
+//!     assert_eq!(unsafe { guile.eval::<Op>(&String::from_str("'(load-const 1)", guile)) }, Ok(Op::LoadConst(1)));
+//!     assert_eq!(unsafe { guile.eval::<Op>(&String::from_str("'(jump -2 #t)", guile)) }, Ok(Op::Jump { offset: -2, relative: true }));
+//!     assert!(unsafe { guile.eval::<Op>(&String::from_str("'load-const", guile)) }.is_err());
+//!     assert!(unsafe { guile.eval::<Op>(&String::from_str("'(load-const 1 2)", guile)) }.is_err());
+//!     assert!(unsafe { guile.eval::<Op>(&String::from_str("'(jump -2 3)", guile)) }.is_err());
+//!
+//!     [Op::Nop, Op::LoadConst(3), Op::Jump { offset: 4, relative: false }]
+//!         .into_iter()
+//!         .for_each(|op| assert_eq!(Op::try_from_scm(op.to_scm(guile), guile), Ok(op)));
+//! }).unwrap();
+//! ```
+
+use crate::{
+    Guile,
+    reference::ReprScm,
+    symbol::Symbol,
+    sys::{SCM, SCM_EOL, scm_car, scm_cdr, scm_gc_protect_object, scm_is_pair},
+    utils::c_predicate,
+};
+
+/// Create an interned symbol that is never garbage collected, so its address can be cached.
+///
+/// # Safety
+///
+/// You must be in guile mode.
+#[doc(hidden)]
+pub unsafe fn make_symbol(name: &str) -> SCM {
+    let guile = unsafe { Guile::new_unchecked_ref() };
+    unsafe { scm_gc_protect_object(Symbol::from_str(name, guile).as_ptr()) }
+}
+
+/// Get the fields of a list headed by `tag` with exactly `N` other elements.
+///
+/// # Safety
+///
+/// You must be in guile mode.
+#[doc(hidden)]
+pub unsafe fn fields<const N: usize>(obj: SCM, tag: SCM) -> Option<[SCM; N]> {
+    if !c_predicate(unsafe { scm_is_pair(obj) }) || unsafe { scm_car(obj) } != tag {
+        return None;
+    }
+
+    let mut fields = [unsafe { SCM_EOL }; N];
+    let mut rest = unsafe { scm_cdr(obj) };
+    for field in fields.iter_mut() {
+        if !c_predicate(unsafe { scm_is_pair(rest) }) {
+            return None;
+        }
+        *field = unsafe { scm_car(rest) };
+        rest = unsafe { scm_cdr(rest) };
+    }
+
+    (rest == unsafe { SCM_EOL }).then_some(fields)
+}